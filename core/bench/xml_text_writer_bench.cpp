@@ -0,0 +1,110 @@
+// Measures how fast XmlTextWriter extracts the text of XML and HTML written in
+// chunks as the tokenizers do. The tokens go to a sink which drops them. Only
+// meaningful in release builds
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <vca/string.h>
+#include <vca/time.h>
+
+namespace
+{
+
+constexpr size_t g_byte_count = 64 * 1024 * 1024;
+
+// as the xml and zipped xml tokenizers write
+constexpr size_t g_chunk_size = 65536;
+
+// the fastest run is reported as the others were disturbed
+constexpr size_t g_run_count = 10;
+
+class NullSink : public vca::TokenSink
+{
+public:
+    void
+    push(const std::string_view /*token*/) override
+    {
+    }
+};
+
+struct Input
+{
+    const char* name;
+    std::string_view unit;
+    bool html;
+};
+
+// tags only, so nothing but the scanner runs
+constexpr std::string_view g_markup =
+    "<w:r><w:rPr><w:rFonts w:ascii=\"Calibri\" w:hAnsi=\"Calibri\"/><w:b/>"
+    "<w:sz w:val=\"24\"/></w:rPr></w:r>\n";
+
+// as in the document.xml of a docx
+constexpr std::string_view g_docx =
+    "<w:p w:rsidR=\"00A12B3C\"><w:pPr><w:pStyle w:val=\"Body\"/></w:pPr>"
+    "<w:r><w:rPr><w:b/></w:rPr><w:t xml:space=\"preserve\">The quarterly "
+    "report covers sales &amp; marketing in all regions. </w:t></w:r></w:p>\n";
+
+constexpr std::string_view g_html =
+    "<p class=\"body\">Caf&eacute; cr&egrave;me &amp; the <b>quick</b> brown "
+    "fox jumps over the lazy dog&#39;s tail &#x2014; twice.</p>\n";
+
+// no markup, so nearly all the time is spent tokenizing
+constexpr std::string_view g_text =
+    "The quick brown fox jumps over the lazy dog and runs into the woods.\n";
+
+std::string
+repeat(const std::string_view unit)
+{
+    std::string data;
+    data.reserve(g_byte_count + unit.size());
+    while (data.size() < g_byte_count)
+    {
+        data += unit;
+    }
+    return data;
+}
+
+double
+measure_gb_per_s(const std::string_view data, const bool html)
+{
+    auto min_us = std::numeric_limits<size_t>::max();
+    for (size_t run = 0; run < g_run_count; ++run)
+    {
+        NullSink sink;
+        const vca::Timer timer;
+        vca::XmlTextWriter writer{sink, html};
+        for (size_t offset = 0; offset < data.size(); offset += g_chunk_size)
+        {
+            writer.write(data.substr(offset, g_chunk_size));
+        }
+        writer.flush();
+        min_us = std::min(min_us, std::max<size_t>(timer.us(), 1));
+    }
+    return static_cast<double>(data.size()) /
+        (static_cast<double>(min_us) * 1000.);
+}
+
+} // namespace
+
+int
+main()
+{
+    const Input inputs[] = {
+        {"markup", g_markup, false},
+        {"docx", g_docx, false},
+        {"html", g_html, true},
+        {"text", g_text, false},
+    };
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& input : inputs)
+    {
+        const auto data = repeat(input.unit);
+        std::cout << std::setw(8) << std::left << input.name
+                  << measure_gb_per_s(data, input.html) << " GB/s\n";
+    }
+}
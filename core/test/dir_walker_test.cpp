@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <vca/dir_walker.h>
+#include <vca/ignore_rules.h>
+
+namespace
+{
+
+vca::Path
+make_tree(const std::string& name,
+          const std::vector<std::pair<std::string, std::string>>& files)
+{
+    const vca::Path root{std::filesystem::temp_directory_path() /
+                         ("vca_dir_walker_test_" + name)};
+    std::filesystem::remove_all(root.to_narrow());
+    for (const auto& [file, data] : files)
+    {
+        const auto path = root / vca::Path{file};
+        vca::create_directories(path.parent());
+        vca::make_ofstream(path) << data;
+    }
+    return root;
+}
+
+std::vector<std::string>
+walk(const vca::Path& root, const std::string& resume_after = {})
+{
+    vca::DirWalker walker{root, {}, resume_after};
+    std::vector<std::string> files;
+    while (walker.next())
+    {
+        files.push_back(walker.relative());
+    }
+    return files;
+}
+
+} // namespace
+
+TEST(dir_walker, withIgnoreFile)
+{
+    const auto root = make_tree("ignore",
+                                {{"a/" + vca::ignore_file_name(), "*.log\n"},
+                                 {"a/x.log", ""},
+                                 {"a/x.txt", ""},
+                                 {"b.log", ""}});
+    const std::vector<std::string> files_exp{
+        "a/" + vca::ignore_file_name(), "a/x.txt", "b.log"};
+    ASSERT_EQ(files_exp, walk(root));
+    std::filesystem::remove_all(root.to_narrow());
+}
+
+TEST(dir_walker, withIgnoreFileInAncestorOfResumedDir)
+{
+    const auto root = make_tree("resume",
+                                {{"a/" + vca::ignore_file_name(), "*.log\n"},
+                                 {"a/b/x.txt", ""},
+                                 {"a/c/y.log", ""},
+                                 {"a/c/y.txt", ""},
+                                 {"d.log", ""}});
+    const std::vector<std::string> files_exp{"a/c/y.txt", "d.log"};
+    ASSERT_EQ(files_exp, walk(root, "a/b/"));
+    std::filesystem::remove_all(root.to_narrow());
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <vca/filesystem.h>
+
+namespace
+{
+
+vca::Path
+write_file(const std::string& name, const std::string& data)
+{
+    const vca::Path path{std::filesystem::temp_directory_path() /
+                         ("vca_filesystem_test_" + name)};
+    auto f = vca::make_ofstream(path, std::ios_base::binary);
+    f << data;
+    return path;
+}
+
+std::string
+make_large_data()
+{
+    std::string data;
+    for (size_t i = 0; data.size() < 4 * 1024 * 1024; ++i)
+    {
+        data += std::to_string(i) + ' ';
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(filesystem, FileReader_withSmallFile)
+{
+    const auto path = write_file("small", "hello world");
+    vca::FileReader reader{path};
+    ASSERT_TRUE(reader.is_open());
+    ASSERT_EQ("hello", reader.read(5));
+    ASSERT_EQ(" world", reader.read(100));
+    ASSERT_TRUE(reader.read(100).empty());
+    vca::remove(path);
+}
+
+TEST(filesystem, FileReader_withLargeFile)
+{
+    const auto data = make_large_data();
+    const auto path = write_file("large", data);
+    vca::FileReader reader{path};
+    ASSERT_TRUE(reader.is_open());
+    std::string data_read;
+    for (auto chunk = reader.read(65536); !chunk.empty();
+         chunk = reader.read(65536))
+    {
+        data_read += chunk;
+    }
+    ASSERT_EQ(data, data_read);
+    vca::remove(path);
+}
+
+TEST(filesystem, FileReader_withTruncatedFile)
+{
+    const auto data = make_large_data();
+    const auto path = write_file("truncated", data);
+    vca::FileReader reader{path};
+    ASSERT_EQ(std::string_view{data}.substr(0, 65536), reader.read(65536));
+    // as when a log is rotated or an editor saves in place
+    std::filesystem::resize_file(std::filesystem::u8path(path.to_narrow()),
+                                 1000);
+    ASSERT_TRUE(reader.read(65536).empty());
+    vca::remove(path);
+}
+
+TEST(filesystem, FileReader_withMissingFile)
+{
+    vca::FileReader reader{vca::Path{"/no/such/file"}};
+    ASSERT_FALSE(reader.is_open());
+    ASSERT_TRUE(reader.read(100).empty());
+}
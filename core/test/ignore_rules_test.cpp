@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <vca/ignore_rules.h>
+
+using Match = vca::IgnoreRules::Match;
+
+TEST(ignore_rules, glob_match)
+{
+    ASSERT_TRUE(vca::glob_match("*.o", "main.o"));
+    ASSERT_FALSE(vca::glob_match("*.o", "main.oo"));
+    ASSERT_FALSE(vca::glob_match("*.o", "src/main.o"));
+    ASSERT_TRUE(vca::glob_match("src/*.o", "src/main.o"));
+    ASSERT_TRUE(vca::glob_match("**/*.o", "main.o"));
+    ASSERT_TRUE(vca::glob_match("**/*.o", "a/b/main.o"));
+    ASSERT_TRUE(vca::glob_match("a/**", "a/b/c"));
+    ASSERT_TRUE(vca::glob_match("a/**/c", "a/c"));
+    ASSERT_TRUE(vca::glob_match("a/**/c", "a/b/b/c"));
+    ASSERT_TRUE(vca::glob_match("file?.txt", "file1.txt"));
+    ASSERT_FALSE(vca::glob_match("file?.txt", "file10.txt"));
+    ASSERT_TRUE(vca::glob_match("[a-c]x", "bx"));
+    ASSERT_FALSE(vca::glob_match("[!a-c]x", "bx"));
+    ASSERT_TRUE(vca::glob_match("\\*x", "*x"));
+    ASSERT_FALSE(vca::glob_match("\\*x", "ax"));
+}
+
+TEST(ignore_rules, withEmptyRules)
+{
+    const vca::IgnoreRules rules;
+    ASSERT_TRUE(rules.empty());
+    ASSERT_EQ(Match::None, rules.match("a/b", false));
+}
+
+TEST(ignore_rules, withNames)
+{
+    const vca::IgnoreRules rules{{"node_modules", ".git/", "# comment", ""}};
+    ASSERT_EQ(Match::Ignored, rules.match("node_modules", true));
+    ASSERT_EQ(Match::Ignored, rules.match("a/b/node_modules", true));
+    ASSERT_EQ(Match::Ignored, rules.match(".git", true));
+    ASSERT_EQ(Match::None, rules.match(".git", false));
+    ASSERT_EQ(Match::None, rules.match("# comment", false));
+    ASSERT_EQ(Match::None, rules.match("src", true));
+}
+
+TEST(ignore_rules, withExtensions)
+{
+    const vca::IgnoreRules rules{{"*.o", "*.tar.gz"}};
+    ASSERT_EQ(Match::Ignored, rules.match("main.o", false));
+    ASSERT_EQ(Match::Ignored, rules.match("src/main.o", false));
+    ASSERT_EQ(Match::Ignored, rules.match("src/a.tar.gz", false));
+    ASSERT_EQ(Match::None, rules.match("src/a.gz", false));
+}
+
+TEST(ignore_rules, withAnchoredPatterns)
+{
+    const vca::IgnoreRules rules{{"/build", "docs/tmp/"}};
+    ASSERT_EQ(Match::Ignored, rules.match("build", true));
+    ASSERT_EQ(Match::None, rules.match("src/build", true));
+    ASSERT_EQ(Match::Ignored, rules.match("docs/tmp", true));
+    ASSERT_EQ(Match::None, rules.match("a/docs/tmp", true));
+}
+
+TEST(ignore_rules, withNegation)
+{
+    const vca::IgnoreRules rules{{"*.log", "!keep.log", "keep.*"}};
+    ASSERT_EQ(Match::Ignored, rules.match("a.log", false));
+    ASSERT_EQ(Match::Ignored, rules.match("keep.log", false));
+    const vca::IgnoreRules rules2{{"*.log", "!keep.log"}};
+    ASSERT_EQ(Match::Included, rules2.match("keep.log", false));
+}
@@ -0,0 +1,16 @@
+#include <gtest/gtest.h>
+
+#include <vca/stopwords.h>
+
+TEST(stopwords, is_stopword)
+{
+    ASSERT_TRUE(vca::is_stopword("the"));
+    ASSERT_TRUE(vca::is_stopword("The"));
+    ASSERT_TRUE(vca::is_stopword("und"));
+    ASSERT_TRUE(vca::is_stopword("für"));
+    ASSERT_TRUE(vca::is_stopword("été"));
+    ASSERT_FALSE(vca::is_stopword("theory"));
+    ASSERT_FALSE(vca::is_stopword("th"));
+    ASSERT_FALSE(vca::is_stopword(""));
+    ASSERT_FALSE(vca::is_stopword("überhaupt"));
+}
@@ -134,6 +134,15 @@ TEST(string, to_upper_case_withSymobols)
     ASSERT_EQ(str_exp, str);
 }
 
+TEST(string, case_mappings_withGreekAndSupplementaryChars)
+{
+    vca::String str = U"ΣΟΦΊΑ 𐐀𞤀 ǅ";
+    vca::to_lower_case(str);
+    ASSERT_EQ(vca::String{U"σοφία 𐐨𞤢 ǆ"}, str);
+    vca::to_upper_case(str);
+    ASSERT_EQ(vca::String{U"ΣΟΦΊΑ 𐐀𞤀 Ǆ"}, str);
+}
+
 TEST(string, is_numeric)
 {
     ASSERT_TRUE(vca::is_numeric(U"0"));
@@ -147,6 +156,30 @@ TEST(string, is_numeric)
     ASSERT_FALSE(vca::is_numeric(U"a0"));
     ASSERT_FALSE(vca::is_numeric(U"a"));
     ASSERT_FALSE(vca::is_numeric(U"abc 123"));
+    ASSERT_TRUE(vca::is_numeric("42"));
+    ASSERT_TRUE(vca::is_numeric(".5e3 "));
+    ASSERT_TRUE(vca::is_numeric("Inf"));
+    ASSERT_TRUE(vca::is_numeric("-NaN"));
+    ASSERT_FALSE(vca::is_numeric("."));
+    ASSERT_FALSE(vca::is_numeric("1e"));
+    ASSERT_FALSE(vca::is_numeric("1e5x"));
+    ASSERT_FALSE(vca::is_numeric("info"));
+}
+
+TEST(string, CharClass)
+{
+    const vca::CharClass some{U'1', U'\x2001', U'\x2003', U'\x2002'};
+    const auto chars = some | vca::CharClass{U'\x2004', U'\x3000'};
+    ASSERT_TRUE(chars.contains(U'1'));
+    ASSERT_FALSE(chars.contains(U'2'));
+    ASSERT_FALSE(chars.contains(U'\x2000'));
+    for (vca::Char c = U'\x2001'; c <= U'\x2004'; ++c)
+    {
+        ASSERT_TRUE(chars.contains(c));
+    }
+    ASSERT_FALSE(chars.contains(U'\x2005'));
+    ASSERT_TRUE(chars.contains(U'\x3000'));
+    ASSERT_FALSE(vca::CharClass{}.contains(U'\x3000'));
 }
 
 TEST(string, replace_all)
@@ -239,3 +272,227 @@ TEST(string, wide_to_narrow_andBack_withEmptyInput)
     const auto wide = vca::narrow_to_wide(narrow);
     ASSERT_EQ(str, wide);
 }
+
+TEST(string, is_valid_utf8)
+{
+    ASSERT_TRUE(vca::is_valid_utf8(""));
+    const auto narrow = vca::wide_to_narrow(U"你好, kühn! 😀");
+    ASSERT_TRUE(vca::is_valid_utf8(narrow));
+    ASSERT_FALSE(vca::is_valid_utf8("k\xfchn"));
+    ASSERT_FALSE(vca::is_valid_utf8("\xc0\xaf"));         // overlong
+    ASSERT_FALSE(vca::is_valid_utf8("\xed\xa0\x80"));     // surrogate
+    ASSERT_FALSE(vca::is_valid_utf8("\xf4\x90\x80\x80")); // > U+10FFFF
+}
+
+TEST(string, is_valid_utf8_withTruncatedInput)
+{
+    const std::string str = "\xe4\xbd";
+    ASSERT_FALSE(vca::is_valid_utf8(str));
+    ASSERT_TRUE(vca::is_valid_utf8(str, true));
+    ASSERT_FALSE(vca::is_valid_utf8("\xe4\x41", true));
+}
+
+namespace
+{
+
+std::unordered_map<std::string_view, size_t>
+counts(const vca::TokenCounter& counter)
+{
+    std::unordered_map<std::string_view, size_t> counts;
+    for (const auto& term : counter.terms())
+    {
+        counts.emplace(term.term, term.frequency);
+    }
+    return counts;
+}
+
+} // namespace
+
+TEST(string, tokenize)
+{
+    vca::TokenCounter counter;
+    vca::tokenize("Hello, world! hello 42 a 你好", counter);
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"Hello", 1}, {"world", 1}, {"hello", 1}, {"你好", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, tokenize_withCjkRuns)
+{
+    vca::TokenCounter counter;
+    vca::tokenize("東京都に行く 本 ｶﾀｶﾅx㐀", counter);
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"東京", 1},
+        {"京都", 1},
+        {"都に", 1},
+        {"に行", 1},
+        {"行く", 1},
+        {"本", 1},
+        {"ｶﾀ", 1},
+        {"ﾀｶ", 1},
+        {"ｶﾅ", 1},
+        {"㐀", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, search_terms)
+{
+    using Terms = std::vector<std::string_view>;
+    ASSERT_EQ(Terms{"report"}, vca::search_terms("report"));
+    ASSERT_EQ(Terms{"本"}, vca::search_terms("本"));
+    ASSERT_EQ((Terms{"東京", "京都"}), vca::search_terms("東京都"));
+    ASSERT_EQ(Terms{"my-file"}, vca::search_terms("my-file"));
+    ASSERT_EQ((Terms{"v2", "東京", "本", "x"}),
+              vca::search_terms("v2東京-本x"));
+}
+
+TEST(string, tokenize_withLongMixedInput)
+{
+    vca::TokenCounter counter;
+    vca::tokenize("an ascii run longer than a vector, then kühn—straße"
+                  "\xe2\x80\xa8zwölf\xe3\x80\x80" "fünf 3.14 1e5",
+                  counter);
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"an", 1},
+        {"ascii", 1},
+        {"run", 1},
+        {"longer", 1},
+        {"than", 1},
+        {"vector", 1},
+        {"then", 1},
+        {"kühn—straße", 1},
+        {"zwölf", 1},
+        {"fünf", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, tokenize_withMalformedInput)
+{
+    vca::TokenCounter counter;
+    vca::tokenize("bad\xff" "bytes\xc3 kept\xe4\xbd", counter);
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"bad", 1}, {"bytes", 1}, {"kept", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, split_words)
+{
+    vca::TokenCounter counter;
+    vca::split_words("my_file-v2 a", counter);
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"my", 1}, {"file", 1}, {"v2", 1}, {"a", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, split_words_withEachAsciiChar)
+{
+    using Counts = std::unordered_map<std::string_view, size_t>;
+    // at each index of a vector, as ASCII runs are split with SIMD
+    const std::string word1(16, 'x');
+    const std::string word2(20, 'y');
+    for (size_t index = 0; index < 16; ++index)
+    {
+        for (vca::Char c = 0; c < 0x80; ++c)
+        {
+            const auto text = word1 + std::string(index, 'x') +
+                static_cast<char>(c) + word2;
+            vca::TokenCounter counter;
+            vca::split_words(text, counter);
+            const std::string_view word1_exp{text.data(), word1.size() + index};
+            const auto counts_exp = vca::separator_chars().contains(c)
+                ? Counts{{word1_exp, 1}, {word2, 1}}
+                : Counts{{text, 1}};
+            ASSERT_EQ(counts_exp, counts(counter)) << static_cast<int>(c);
+        }
+    }
+}
+
+TEST(string, xml_unescape)
+{
+    std::string text = "a &lt;b&gt; &amp;lt; &amp c&quot;";
+    vca::xml_unescape(text);
+    ASSERT_EQ("a <b> &lt; &amp c\"", text);
+}
+
+TEST(string, xml_unescape_withNumericEntities)
+{
+    std::string text = "&#65;&#x42;&#X43; &#252;&#x1F600; &#xd800; &#; &#x;";
+    vca::xml_unescape(text);
+    ASSERT_EQ("ABC ü😀 &#xd800; &#; &#x;", text);
+}
+
+TEST(string, TokenCounter_terms)
+{
+    vca::TokenCounter counter;
+    vca::tokenize("to be or not to be", counter);
+    const std::vector<vca::Term> terms_exp{
+        {"be", 2, 1}, {"not", 1, 3}, {"or", 1, 2}, {"to", 2, 0}};
+    ASSERT_EQ(terms_exp, counter.terms(true));
+    counter.clear();
+    vca::tokenize("be", counter);
+    const std::vector<vca::Term> cleared_exp{{"be", 1, 0}};
+    ASSERT_EQ(cleared_exp, counter.terms());
+}
+
+TEST(string, TokenWriter_withChunks)
+{
+    vca::TokenCounter counter;
+    vca::TokenWriter writer{counter};
+    const std::string text = "the quick brown fox jumps over the hyphen-\n"
+                             "ated lazy dog\n";
+    for (const auto c : text)
+    {
+        writer.write(std::string(1, c));
+    }
+    writer.flush();
+    const std::unordered_map<std::string_view, size_t> counts_exp{{"the", 2},
+                                                             {"quick", 1},
+                                                             {"brown", 1},
+                                                             {"fox", 1},
+                                                             {"jumps", 1},
+                                                             {"over", 1},
+                                                             {"hyphenated", 1},
+                                                             {"lazy", 1},
+                                                             {"dog", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, XmlTextWriter_withChunks)
+{
+    vca::TokenCounter counter;
+    vca::XmlTextWriter writer{counter};
+    const std::string xml = "<?xml version=\"1.0\"?><doc><p>Tom &amp; "
+                            "Jerry</p><p attr=\"ignored\">hyphen-</p>"
+                            "<p>ated <b>bold</b>text</p></doc>";
+    for (const auto c : xml)
+    {
+        writer.write(std::string(1, c));
+    }
+    writer.flush();
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"Tom", 1},
+        {"Jerry", 1},
+        {"hyphenated", 1},
+        {"bold", 1},
+        {"text", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
+
+TEST(string, XmlTextWriter_withHtml)
+{
+    vca::TokenCounter counter;
+    vca::XmlTextWriter writer{counter, true};
+    const std::string html =
+        "<html><head><style>body { color: red; }</style>"
+        "<script>if (a<b && c>d) { hidden(); }</script></head>"
+        "<body><p>caf&#xe9;&nbsp;cr&egrave;me</p><SCRIPT>more</SCRIPT>"
+        "<!-- comment --></body></html>";
+    for (const auto c : html)
+    {
+        writer.write(std::string(1, c));
+    }
+    writer.flush();
+    const std::unordered_map<std::string_view, size_t> counts_exp{
+        {"café", 1}, {"crème", 1}};
+    ASSERT_EQ(counts_exp, counts(counter));
+}
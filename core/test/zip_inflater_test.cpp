@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vca/zip_inflater.h>
+
+namespace
+{
+
+const vca::Path g_docx{std::string{VCA_SOURCE_DIR} +
+                       "/test/data/Reports/Project proposal.docx"};
+
+// has two worksheets, each inflated in one chunk or more
+const vca::Path g_xlsx{std::string{VCA_SOURCE_DIR} +
+                       "/test/data/SpreadSheets/Monthly budget.xlsx"};
+
+const std::string g_sheets = "xl/worksheets/sheet\\d+.xml";
+
+std::vector<std::string>
+inflate_chunks(const vca::Path& file,
+               const std::string& pattern,
+               const size_t max_byte_count,
+               size_t& byte_count)
+{
+    std::vector<std::string> chunks;
+    byte_count = vca::inflate_zip(file,
+                                  vca::ZipEntryMatcher{pattern},
+                                  max_byte_count,
+                                  [&chunks](const std::string_view chunk)
+                                  {
+                                      chunks.emplace_back(chunk);
+                                      return true;
+                                  });
+    return chunks;
+}
+
+std::string
+inflate(const vca::Path& file,
+        const std::string& pattern,
+        const size_t max_byte_count = std::string::npos)
+{
+    size_t byte_count = 0;
+    std::string data;
+    for (const auto& chunk :
+         inflate_chunks(file, pattern, max_byte_count, byte_count))
+    {
+        data += chunk;
+    }
+    EXPECT_EQ(data.size(), byte_count);
+    return data;
+}
+
+} // namespace
+
+TEST(zip_inflater, ZipEntryMatcher_withName)
+{
+    const vca::ZipEntryMatcher matcher{"word/document.xml"};
+    ASSERT_EQ("word/document.xml", matcher.name());
+    ASSERT_TRUE(matcher.matches("word/document.xml"));
+    ASSERT_FALSE(matcher.matches("word/documentxxml"));
+    ASSERT_FALSE(matcher.matches("word/document.xml.rels"));
+}
+
+TEST(zip_inflater, ZipEntryMatcher_withRegex)
+{
+    const vca::ZipEntryMatcher matcher{"ppt/slides/slide[0-9]\\d*.xml"};
+    ASSERT_FALSE(matcher.name());
+    ASSERT_TRUE(matcher.matches("ppt/slides/slide1.xml"));
+    ASSERT_TRUE(matcher.matches("ppt/slides/slide12.xml"));
+    ASSERT_FALSE(matcher.matches("ppt/slides/slide.xml"));
+    ASSERT_FALSE(matcher.matches("ppt/slides/_rels/slide1.xml.rels"));
+}
+
+TEST(zip_inflater, ZipEntryMatcher_withOptionalPrefixChar)
+{
+    const vca::ZipEntryMatcher matcher{"docs?/a.xml"};
+    ASSERT_FALSE(matcher.name());
+    ASSERT_TRUE(matcher.matches("doc/a.xml"));
+    ASSERT_TRUE(matcher.matches("docs/a.xml"));
+}
+
+TEST(zip_inflater, inflate_zip_withName)
+{
+    const auto data = inflate(g_docx, "word/document.xml");
+    ASSERT_EQ(23634, data.size());
+    ASSERT_EQ(0, data.find("<?xml"));
+    ASSERT_EQ("</w:document>", data.substr(data.size() - 13));
+}
+
+TEST(zip_inflater, inflate_zip_withRegex)
+{
+    size_t byte_count = 0;
+    const auto chunks =
+        inflate_chunks(g_xlsx, g_sheets, std::string::npos, byte_count);
+    ASSERT_LE(2, chunks.size());
+    std::string data;
+    for (const auto& chunk : chunks)
+    {
+        ASSERT_FALSE(chunk.empty());
+        data += chunk;
+    }
+    // in the order of the archive, each entry as a whole
+    const auto sheet1 = inflate(g_xlsx, "xl/worksheets/sheet1.xml");
+    const auto sheet2 = inflate(g_xlsx, "xl/worksheets/sheet2.xml");
+    ASSERT_EQ(22932, sheet1.size());
+    ASSERT_EQ(10436, sheet2.size());
+    ASSERT_EQ(sheet1 + sheet2, data);
+    ASSERT_EQ(data.size(), byte_count);
+}
+
+TEST(zip_inflater, inflate_zip_withNoMatch)
+{
+    size_t byte_count = 0;
+    ASSERT_TRUE(inflate_chunks(g_xlsx, "xl/charts/chart\\d+.xml", 1000,
+                               byte_count)
+                    .empty());
+    ASSERT_EQ(0, byte_count);
+    ASSERT_TRUE(
+        inflate_chunks(g_docx, "word/missing.xml", 1000, byte_count).empty());
+    ASSERT_EQ(0, byte_count);
+}
+
+TEST(zip_inflater, inflate_zip_withMaxByteCount)
+{
+    const auto data = inflate(g_xlsx, g_sheets);
+    ASSERT_EQ(data.substr(0, 1000), inflate(g_xlsx, g_sheets, 1000));
+    // ends in the second entry
+    ASSERT_EQ(data.substr(0, 25000), inflate(g_xlsx, g_sheets, 25000));
+    ASSERT_TRUE(inflate(g_xlsx, g_sheets, 0).empty());
+}
+
+TEST(zip_inflater, inflate_zip_withStop)
+{
+    const auto data = inflate(g_xlsx, g_sheets);
+    std::vector<std::string> chunks;
+    const auto byte_count =
+        vca::inflate_zip(g_xlsx,
+                         vca::ZipEntryMatcher{g_sheets},
+                         std::string::npos,
+                         [&chunks](const std::string_view chunk)
+                         {
+                             chunks.emplace_back(chunk);
+                             return false;
+                         });
+    ASSERT_EQ(1, chunks.size());
+    ASSERT_EQ(chunks[0].size(), byte_count);
+    ASSERT_LT(byte_count, data.size());
+    ASSERT_EQ(data.substr(0, byte_count), chunks[0]);
+}
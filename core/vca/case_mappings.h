@@ -1,16 +1,16 @@
 #pragma once
 
-#include <unordered_map>
-
 #include "string.h"
 
 namespace vca
 {
 
-const std::unordered_map<Char, Char>&
-lower_to_upper_map();
+// Returns the simple lower case mapping of c, or c if there is none
+Char
+lower_case(Char c);
 
-const std::unordered_map<Char, Char>&
-upper_to_lower_map();
+// Returns the simple upper case mapping of c, or c if there is none
+Char
+upper_case(Char c);
 
 } // namespace vca
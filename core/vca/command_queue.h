@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <memory>
@@ -43,4 +44,21 @@ private:
     std::unique_ptr<Impl> m_impl;
 };
 
+// Waits for a command pushed from another thread. Returns false if done is set
+// in the meantime as the main thread may be waiting for that thread to finish
+template <typename T>
+bool
+wait(const std::future<T>& future, const std::atomic<bool>& done)
+{
+    while (future.wait_for(std::chrono::milliseconds{10}) !=
+           std::future_status::ready)
+    {
+        if (done)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace vca
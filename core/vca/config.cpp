@@ -22,10 +22,40 @@ namespace
 struct Keys
 {
     constexpr static const char* const root_dirs = "root_dirs";
+    constexpr static const char* const exclusions = "exclusions";
+    constexpr static const char* const polled_dirs = "polled_dirs";
+    constexpr static const char* const full_text = "full_text";
+    constexpr static const char* const extraction_limits = "extraction_limits";
+    constexpr static const char* const max_bytes = "max_bytes";
+    constexpr static const char* const max_ms = "max_ms";
     constexpr static const char* const host = "host";
     constexpr static const char* const port = "port";
 };
 
+IgnoreRules
+default_exclusions()
+{
+    return IgnoreRules{{".git/",
+                        ".hg/",
+                        ".svn/",
+                        "node_modules/",
+                        "__pycache__/",
+                        ".cache/"}};
+}
+
+constexpr size_t g_default_max_time_ms = 5000;
+
+std::map<std::string, ExtractionLimits>
+default_extraction_limits()
+{
+    return {{"html", {16384, g_default_max_time_ms}},
+            {"pdf", {8192, g_default_max_time_ms}},
+            {"tex", {81920, g_default_max_time_ms}},
+            {"txt", {16384, g_default_max_time_ms}},
+            {"xml", {16384, g_default_max_time_ms}},
+            {"zipxml", {81920, g_default_max_time_ms}}};
+}
+
 } // namespace
 
 struct UserConfig::Impl : public efsw::FileWatchListener
@@ -124,6 +154,52 @@ struct UserConfig::Impl : public efsw::FileWatchListener
             root_dirs.emplace(std::move(p));
         }
         normalize_root_dirs();
+        if (j.contains(Keys::exclusions))
+        {
+            std::vector<std::string> patterns;
+            for (const auto& pattern : j[Keys::exclusions])
+            {
+                patterns.emplace_back(pattern.get<std::string>());
+            }
+            exclusions = IgnoreRules{std::move(patterns)};
+        }
+        else
+        {
+            exclusions = default_exclusions();
+        }
+        full_text =
+            j.contains(Keys::full_text) && j[Keys::full_text].get<bool>();
+        extraction_limits = default_extraction_limits();
+        if (j.contains(Keys::extraction_limits))
+        {
+            const auto& limits_by_name = j[Keys::extraction_limits];
+            for (const auto& [name, limits] : limits_by_name.items())
+            {
+                auto& l = extraction_limits[name];
+                if (limits.contains(Keys::max_bytes))
+                {
+                    l.max_byte_count = limits[Keys::max_bytes].get<size_t>();
+                }
+                if (limits.contains(Keys::max_ms))
+                {
+                    l.max_time_ms = limits[Keys::max_ms].get<size_t>();
+                }
+            }
+        }
+        polled_dirs.clear();
+        if (j.contains(Keys::polled_dirs))
+        {
+            for (const auto& dir : j[Keys::polled_dirs])
+            {
+                const auto p = native_path(Path{dir.get<std::string>()});
+                if (root_dirs.count(p) == 0)
+                {
+                    VCA_ERROR << "polled dir is not a root_dir: " << p;
+                    continue;
+                }
+                polled_dirs.emplace(p);
+            }
+        }
     }
 
     void
@@ -136,6 +212,10 @@ struct UserConfig::Impl : public efsw::FileWatchListener
             VCA_CHECK(valid_root_dir(dir));
         }
         root_dirs.emplace(std::move(dir));
+        exclusions = default_exclusions();
+        polled_dirs.clear();
+        full_text = false;
+        extraction_limits = default_extraction_limits();
     }
 
     void
@@ -148,6 +228,26 @@ struct UserConfig::Impl : public efsw::FileWatchListener
             dirs.push_back(dir.to_narrow());
         }
         j[Keys::root_dirs] = dirs;
+        auto patterns = json::array();
+        for (const auto& pattern : exclusions.patterns())
+        {
+            patterns.push_back(pattern);
+        }
+        j[Keys::exclusions] = patterns;
+        auto polled = json::array();
+        for (const auto& dir : polled_dirs)
+        {
+            polled.push_back(dir.to_narrow());
+        }
+        j[Keys::polled_dirs] = polled;
+        j[Keys::full_text] = full_text;
+        auto limits = json::object();
+        for (const auto& [name, l] : extraction_limits)
+        {
+            limits[name][Keys::max_bytes] = l.max_byte_count;
+            limits[name][Keys::max_ms] = l.max_time_ms;
+        }
+        j[Keys::extraction_limits] = limits;
         make_ofstream(path) << j;
     }
 
@@ -213,6 +313,10 @@ struct UserConfig::Impl : public efsw::FileWatchListener
     UserConfig& user_config;
     Path path;
     std::set<Path> root_dirs;
+    IgnoreRules exclusions;
+    std::set<Path> polled_dirs;
+    bool full_text = false;
+    std::map<std::string, ExtractionLimits> extraction_limits;
     std::set<UserConfig::Observer*> observers;
     efsw::FileWatcher file_watcher;
     efsw::WatchID watch;
@@ -251,6 +355,34 @@ UserConfig::root_dirs() const
     return m_impl->root_dirs;
 }
 
+const IgnoreRules&
+UserConfig::exclusions() const
+{
+    return m_impl->exclusions;
+}
+
+const std::set<Path>&
+UserConfig::polled_dirs() const
+{
+    return m_impl->polled_dirs;
+}
+
+ExtractionLimits
+UserConfig::extraction_limits(const std::string& tokenizer) const
+{
+    ExtractionLimits limits{0, g_default_max_time_ms};
+    const auto it = m_impl->extraction_limits.find(tokenizer);
+    if (it != m_impl->extraction_limits.end())
+    {
+        limits = it->second;
+    }
+    if (m_impl->full_text)
+    {
+        limits.max_byte_count = 0;
+    }
+    return limits;
+}
+
 void
 UserConfig::add_observer(Observer& observer)
 {
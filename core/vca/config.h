@@ -1,15 +1,25 @@
 #pragma once
 
+#include <map>
 #include <set>
 #include <string>
 
 #include "command_queue.h"
 #include "filesystem.h"
+#include "ignore_rules.h"
 #include "string.h"
 
 namespace vca
 {
 
+// Limits of the text extracted from a file by a tokenizer, zero meaning
+// unlimited
+struct ExtractionLimits
+{
+    size_t max_byte_count = 0;
+    size_t max_time_ms = 0;
+};
+
 class UserConfig
 {
 public:
@@ -37,6 +47,20 @@ public:
     const std::set<Path>&
     root_dirs() const;
 
+    // Patterns of files and dirs to skip in all root dirs
+    const IgnoreRules&
+    exclusions() const;
+
+    // Root dirs, e.g. on network shares, checked for changes by polling as
+    // they don't support file watching
+    const std::set<Path>&
+    polled_dirs() const;
+
+    // Returns the limits for the tokenizer of the given name. In full-text
+    // mode there are no byte limits
+    ExtractionLimits
+    extraction_limits(const std::string& tokenizer) const;
+
     void
     add_observer(Observer& observer);
 
@@ -0,0 +1,187 @@
+#include "dir_walker.h"
+
+#include <algorithm>
+
+#include "logging.h"
+
+namespace vca
+{
+
+DirWalker::DirWalker(const Path& root_dir,
+                     IgnoreRules rules,
+                     std::string resume_after)
+    : m_rules{std::move(rules)}
+    , m_resume_after{std::move(resume_after)}
+    , m_completed_dir{m_resume_after}
+{
+    push_frame(root_dir, {});
+}
+
+bool
+DirWalker::next()
+{
+    while (!m_frames.empty())
+    {
+        auto& frame = m_frames.back();
+        if (frame.index == frame.entries.size())
+        {
+            m_completed_dir = std::move(frame.prefix);
+            m_frames.pop_back();
+            continue;
+        }
+        auto& entry = frame.entries[frame.index++];
+        if (entry.is_dir)
+        {
+            const auto dir = std::move(entry.path);
+            push_frame(dir, frame.prefix + entry.key);
+            continue;
+        }
+        m_path = std::move(entry.path);
+        m_relative = frame.prefix + entry.key;
+        return true;
+    }
+    return false;
+}
+
+const Path&
+DirWalker::path() const
+{
+    return m_path;
+}
+
+const std::string&
+DirWalker::relative() const
+{
+    return m_relative;
+}
+
+const std::string&
+DirWalker::completed_dir() const
+{
+    return m_completed_dir;
+}
+
+void
+DirWalker::push_frame(const Path& dir, std::string prefix)
+{
+    constexpr auto separator =
+        static_cast<char>(std::filesystem::path::preferred_separator);
+
+    Frame frame;
+    frame.prefix = std::move(prefix);
+
+    // Only use the file types cached by the listing here so that ignored
+    // entries are pruned without a stat
+    std::vector<Entry> symlinks;
+    bool has_ignore_file = false;
+    std::error_code ec;
+    for (auto it = make_dir_iterator(dir, ec);
+         !ec && it != std::filesystem::directory_iterator{};
+         it.increment(ec))
+    {
+        // like the recursive iterator, don't follow symlinked dirs
+        std::error_code type_ec;
+        const auto is_symlink = it->is_symlink(type_ec);
+        const auto is_dir = !is_symlink && it->is_directory(type_ec);
+        if (!is_dir && !is_symlink && !it->is_regular_file(type_ec))
+        {
+            continue;
+        }
+        auto key = it->path().filename().u8string();
+        if (is_dir)
+        {
+            key += separator;
+        }
+        // the rules apply to the rest of the dir even if the ignore file
+        // itself sorts before the point a walk was resumed at
+        if (!is_dir && key == ignore_file_name())
+        {
+            has_ignore_file = true;
+        }
+        if (is_completed(frame.prefix + key, is_dir))
+        {
+            continue;
+        }
+        auto& entries = is_symlink ? symlinks : frame.entries;
+        entries.push_back(Entry{std::move(key), Path{it->path()}, is_dir});
+    }
+    if (ec)
+    {
+        VCA_WARN << "Cannot list dir: " << dir << " - " << ec.message();
+    }
+
+    if (has_ignore_file)
+    {
+        frame.rules = IgnoreRules::from_file(dir / Path{ignore_file_name()});
+    }
+    const auto is_ignored = [this, &frame](const Entry& entry) {
+        return this->is_ignored(frame, entry);
+    };
+    frame.entries.erase(std::remove_if(frame.entries.begin(),
+                                       frame.entries.end(),
+                                       is_ignored),
+                        frame.entries.end());
+    for (auto& entry : symlinks)
+    {
+        if (!is_ignored(entry) && entry.path.is_file())
+        {
+            frame.entries.emplace_back(std::move(entry));
+        }
+    }
+
+    std::sort(frame.entries.begin(),
+              frame.entries.end(),
+              [](const Entry& l, const Entry& r) { return l.key < r.key; });
+    m_frames.push_back(std::move(frame));
+}
+
+bool
+DirWalker::is_ignored(const Frame& frame, const Entry& entry) const
+{
+    auto relative = frame.prefix + entry.key;
+    if (entry.is_dir)
+    {
+        relative.pop_back();
+    }
+    // rules in deeper dirs take precedence
+    auto match = m_rules.match(relative, entry.is_dir);
+    const auto match_scope = [&](const Frame& scope) {
+        if (scope.rules)
+        {
+            const auto m = scope.rules->match(
+                std::string_view{relative}.substr(scope.prefix.size()),
+                entry.is_dir);
+            if (m != IgnoreRules::Match::None)
+            {
+                match = m;
+            }
+        }
+    };
+    for (const auto& scope : m_frames)
+    {
+        match_scope(scope);
+    }
+    match_scope(frame);
+    return match == IgnoreRules::Match::Ignored;
+}
+
+bool
+DirWalker::is_completed(const std::string& key, const bool is_dir) const
+{
+    if (m_resume_after.empty())
+    {
+        return false;
+    }
+    const auto is_prefix = [](const std::string& prefix,
+                              const std::string& str) {
+        return str.compare(0, prefix.size(), prefix) == 0;
+    };
+    // dirs on the path to the completed dir were only partially walked
+    if (is_dir && key != m_resume_after && is_prefix(key, m_resume_after))
+    {
+        return false;
+    }
+    return key < m_resume_after || is_prefix(m_resume_after, key);
+}
+
+} // namespace vca
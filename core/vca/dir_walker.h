@@ -0,0 +1,86 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "ignore_rules.h"
+#include "utils.h"
+
+namespace vca
+{
+
+// Walks a directory tree depth-first and visits its files in the byte-wise
+// order of their paths relative to the root dir. That is the order in which
+// SQLite sorts these paths by default which allows for merging a walk with a
+// sorted index query in a single pass. Memory use is bounded by the size of
+// the directories on the current path and not by the size of the tree.
+//
+// Entries matching the given rules or the rules of ignore files found along
+// the way are pruned as the dirs are listed.
+//
+// A walk can be resumed after a dir completed by an earlier walk in which case
+// everything sorting up to the end of that dir is skipped without listing it.
+class DirWalker
+{
+public:
+    explicit DirWalker(const Path& root_dir,
+                       IgnoreRules rules = {},
+                       std::string resume_after = {});
+
+    VCA_DELETE_COPY(DirWalker)
+    VCA_DEFAULT_MOVE(DirWalker)
+
+    // Advances to the next file. Returns false once the walk is complete
+    bool
+    next();
+
+    const Path&
+    path() const;
+
+    const std::string&
+    relative() const;
+
+    // The relative path (with a trailing separator) of the dir most recently
+    // completed, i.e. all of whose files have been visited. Empty once the
+    // walk is complete
+    const std::string&
+    completed_dir() const;
+
+private:
+    struct Entry
+    {
+        // the file name, with a trailing separator for directories
+        std::string key;
+        Path path;
+        bool is_dir;
+    };
+
+    struct Frame
+    {
+        std::string prefix;
+        std::vector<Entry> entries;
+        size_t index = 0;
+        // the rules of the ignore file in this dir
+        std::optional<IgnoreRules> rules;
+    };
+
+    void
+    push_frame(const Path& dir, std::string prefix);
+
+    bool
+    is_ignored(const Frame& frame, const Entry& entry) const;
+
+    bool
+    is_completed(const std::string& key, bool is_dir) const;
+
+    IgnoreRules m_rules;
+    std::string m_resume_after;
+    std::string m_completed_dir;
+    std::vector<Frame> m_frames;
+    Path m_path;
+    std::string m_relative;
+};
+
+} // namespace vca
@@ -1,11 +1,17 @@
 #include "filesystem.h"
 
+#include <cerrno>
 #include <iostream>
 
 #include <boost/filesystem.hpp>
 #include <cryptopp/crc.h>
 #include <sago/platform_folders.h>
 
+#ifdef VCA_PLATFORM_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "utils.h"
 
 namespace vca
@@ -15,12 +21,9 @@ Fingerprint
 Fingerprint::from_path(const Path& f)
 {
     VCA_CHECK(f.is_file());
-    // std::filesystem doesn't have a file_time to time_t conversion :(
-    const auto last_write_time = static_cast<uint64_t>(
-        boost::filesystem::last_write_time(f.to_narrow()));
     auto file = make_ifstream(f, std::ios_base::binary);
     VCA_CHECK(file.good());
-    return from_stream(file, f.size(), last_write_time);
+    return from_stream(file, f.size(), f.last_write_time());
 }
 
 Fingerprint
@@ -100,6 +103,7 @@ Fingerprint::serialize() const
 Fingerprint
 Fingerprint::deserialize(const std::vector<unsigned char>& d)
 {
+    VCA_CHECK(d.size() == sizeof(Fingerprint));
     Fingerprint fp;
     std::memcpy(
         reinterpret_cast<unsigned char*>(&fp), d.data(), sizeof(Fingerprint));
@@ -124,6 +128,14 @@ operator==(const Fingerprint& l, const Fingerprint& r)
     return true;
 }
 
+uint64_t
+Path::last_write_time() const
+{
+    // std::filesystem doesn't have a file_time to time_t conversion :(
+    return static_cast<uint64_t>(
+        boost::filesystem::last_write_time(to_narrow()));
+}
+
 bool
 Path::is_parent_of(const Path& a_child) const
 {
@@ -167,15 +179,84 @@ user_documents_dir()
     return Path{sago::getDocumentsFolder()};
 }
 
-std::string
-read_text(std::istream& f, const size_t max_byte_count)
+struct FileReader::Impl
+{
+#ifdef VCA_PLATFORM_UNIX
+    ~Impl()
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    int fd = -1;
+#else
+    std::ifstream stream;
+#endif
+    std::string buffer;
+};
+
+FileReader::FileReader(const Path& file)
+    : m_impl{std::make_unique<Impl>()}
 {
-    VCA_CHECK(f.good());
-    std::string data(max_byte_count, 0);
-    f.read(data.data(), data.size());
-    const auto byte_count = f.gcount();
-    data.resize(byte_count);
-    return data;
+#ifdef VCA_PLATFORM_UNIX
+    m_impl->fd = ::open(file.to_narrow().c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef POSIX_FADV_SEQUENTIAL
+    // macOS has no fadvise
+    if (m_impl->fd >= 0)
+    {
+        ::posix_fadvise(m_impl->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+#else
+    m_impl->stream = make_ifstream(file, std::ios_base::binary);
+#endif
+}
+
+FileReader::~FileReader() = default;
+
+bool
+FileReader::is_open() const
+{
+#ifdef VCA_PLATFORM_UNIX
+    return m_impl->fd >= 0;
+#else
+    return static_cast<bool>(m_impl->stream);
+#endif
+}
+
+std::string_view
+FileReader::read(const size_t max_byte_count)
+{
+    auto& buffer = m_impl->buffer;
+    if (buffer.size() < max_byte_count)
+    {
+        buffer.resize(max_byte_count);
+    }
+    size_t byte_count = 0;
+#ifdef VCA_PLATFORM_UNIX
+    while (m_impl->fd >= 0 && byte_count < max_byte_count)
+    {
+        const auto count = ::read(m_impl->fd,
+                                  buffer.data() + byte_count,
+                                  max_byte_count - byte_count);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        byte_count += static_cast<size_t>(count);
+    }
+#else
+    m_impl->stream.read(buffer.data(),
+                        static_cast<std::streamsize>(max_byte_count));
+    byte_count = static_cast<size_t>(m_impl->stream.gcount());
+#endif
+    return {buffer.data(), byte_count};
 }
 
 } // namespace vca
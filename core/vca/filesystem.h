@@ -3,6 +3,9 @@
 #include <array>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -30,6 +33,18 @@ public:
     static Fingerprint
     deserialize(const std::vector<unsigned char>& data);
 
+    uint64_t
+    size() const
+    {
+        return m_size;
+    }
+
+    uint64_t
+    last_write_time() const
+    {
+        return m_last_write_time;
+    }
+
 private:
     friend bool
     operator==(const Fingerprint& l, const Fingerprint& r);
@@ -142,6 +157,9 @@ public:
         return std::filesystem::file_size(m_path);
     }
 
+    uint64_t
+    last_write_time() const;
+
     Path
     parent() const
     {
@@ -169,7 +187,7 @@ public:
     void
     compute_fingerprint()
     {
-        *m_fingerprint = Fingerprint::from_path(*this);
+        m_fingerprint = Fingerprint::from_path(*this);
     }
 
     const std::optional<Fingerprint>&
@@ -197,6 +215,9 @@ private:
     friend inline auto
     make_rec_dir_iterator(const Path& p);
 
+    friend inline auto
+    make_dir_iterator(const Path& p, std::error_code& ec);
+
     friend inline std::ifstream
     make_ifstream(const Path& p, std::ios_base::openmode mode);
 
@@ -258,6 +279,12 @@ make_rec_dir_iterator(const Path& p)
     return std::filesystem::recursive_directory_iterator{p.m_path};
 }
 
+inline auto
+make_dir_iterator(const Path& p, std::error_code& ec)
+{
+    return std::filesystem::directory_iterator{p.m_path, ec};
+}
+
 inline std::ifstream
 make_ifstream(const Path& p, std::ios_base::openmode mode = std::ios_base::in)
 {
@@ -276,8 +303,31 @@ user_config_dir();
 Path
 user_documents_dir();
 
-std::string
-read_text(std::istream& f, size_t max_byte_count);
+// Reads a file from start to end through a buffer reused for each read.
+// Unlike a memory mapping of it, a file truncated meanwhile just ends early
+class FileReader
+{
+public:
+    explicit FileReader(const Path& file);
+
+    VCA_DELETE_COPY(FileReader)
+    VCA_DELETE_MOVE(FileReader)
+
+    ~FileReader();
+
+    // False if the file couldn't be opened
+    bool
+    is_open() const;
+
+    // The next max_byte_count bytes of the file, less only at its end or on
+    // errors. Valid until the next read
+    std::string_view
+    read(size_t max_byte_count);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
 
 inline Path
 native_path(const Path& path)
@@ -0,0 +1,418 @@
+#include "ignore_rules.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace vca
+{
+
+namespace
+{
+
+constexpr bool
+is_separator(const char c)
+{
+    return c == '/' ||
+        c == static_cast<char>(std::filesystem::path::preferred_separator);
+}
+
+bool
+has_wildcards(std::string_view str)
+{
+    return str.find_first_of("*?[\\") != std::string_view::npos;
+}
+
+std::string_view
+file_name(std::string_view relative)
+{
+    for (auto i = relative.size(); i > 0; --i)
+    {
+        if (is_separator(relative[i - 1]))
+        {
+            return relative.substr(i);
+        }
+    }
+    return relative;
+}
+
+// Matches c against the class starting after '[' in glob at index i. On
+// return i is past the closing ']'
+bool
+match_class(std::string_view glob, size_t& i, const char c)
+{
+    bool negated = false;
+    if (i < glob.size() && (glob[i] == '!' || glob[i] == '^'))
+    {
+        negated = true;
+        ++i;
+    }
+    bool matched = false;
+    bool first = true;
+    while (i < glob.size() && (first || glob[i] != ']'))
+    {
+        first = false;
+        auto lo = glob[i++];
+        if (lo == '\\' && i < glob.size())
+        {
+            lo = glob[i++];
+        }
+        auto hi = lo;
+        if (i + 1 < glob.size() && glob[i] == '-' && glob[i + 1] != ']')
+        {
+            hi = glob[i + 1];
+            i += 2;
+        }
+        if (c >= lo && c <= hi)
+        {
+            matched = true;
+        }
+    }
+    ++i; // the closing ']'
+    return matched != negated;
+}
+
+} // namespace
+
+const std::string&
+ignore_file_name()
+{
+    static const std::string name{".findleignore"};
+    return name;
+}
+
+IgnoreRules::IgnoreRules(std::vector<std::string> patterns)
+    : m_sources{std::move(patterns)}
+{
+    for (const auto& source : m_sources)
+    {
+        std::string_view line{source};
+        while (!line.empty() &&
+               (line.back() == ' ' || line.back() == '\t' ||
+                line.back() == '\r'))
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#')
+        {
+            continue;
+        }
+
+        Pattern pattern;
+        if (line.front() == '!')
+        {
+            pattern.negated = true;
+            line.remove_prefix(1);
+        }
+        if (!line.empty() && line.back() == '/')
+        {
+            pattern.dir_only = true;
+            line.remove_suffix(1);
+        }
+        if (!line.empty() && line.front() == '/')
+        {
+            pattern.anchored = true;
+            line.remove_prefix(1);
+        }
+        else if (line.substr(0, 3) == "**/" &&
+                 line.find('/', 3) == std::string_view::npos)
+        {
+            line.remove_prefix(3);
+        }
+        else
+        {
+            pattern.anchored = line.find('/') != std::string_view::npos;
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        pattern.glob = line;
+
+        const auto index = m_patterns.size();
+        const auto rest = line.substr(1);
+        if (!pattern.anchored && !has_wildcards(line))
+        {
+            m_names[pattern.glob].push_back(index);
+        }
+        else if (!pattern.anchored && line.front() == '*' &&
+                 rest.size() > 1 && rest.front() == '.' &&
+                 rest.find('.', 1) == std::string_view::npos &&
+                 !has_wildcards(rest))
+        {
+            m_extensions[std::string{rest}].push_back(index);
+        }
+        else
+        {
+            m_globs.push_back(index);
+        }
+        m_patterns.emplace_back(std::move(pattern));
+    }
+}
+
+IgnoreRules
+IgnoreRules::from_file(const Path& file)
+{
+    std::vector<std::string> patterns;
+    auto f = make_ifstream(file);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        patterns.emplace_back(std::move(line));
+    }
+    return IgnoreRules{std::move(patterns)};
+}
+
+bool
+IgnoreRules::empty() const
+{
+    return m_patterns.empty();
+}
+
+const std::vector<std::string>&
+IgnoreRules::patterns() const
+{
+    return m_sources;
+}
+
+IgnoreRules::Match
+IgnoreRules::match(std::string_view relative, const bool is_dir) const
+{
+    if (m_patterns.empty())
+    {
+        return Match::None;
+    }
+
+    const auto name = file_name(relative);
+    constexpr auto none = static_cast<size_t>(-1);
+    auto best = none;
+    // indices are ascending so the first match from the back is the last
+    // matching pattern of the given ones
+    const auto find_last = [&](const std::vector<size_t>& indices) {
+        for (auto it = indices.rbegin(); it != indices.rend(); ++it)
+        {
+            if (best != none && *it < best)
+            {
+                break;
+            }
+            if (matches(*it, relative, name, is_dir))
+            {
+                best = *it;
+                break;
+            }
+        }
+    };
+
+    if (!m_names.empty())
+    {
+        const auto it = m_names.find(std::string{name});
+        if (it != m_names.end())
+        {
+            find_last(it->second);
+        }
+    }
+    if (!m_extensions.empty())
+    {
+        const auto dot = name.rfind('.');
+        if (dot != std::string_view::npos)
+        {
+            const auto it = m_extensions.find(std::string{name.substr(dot)});
+            if (it != m_extensions.end())
+            {
+                find_last(it->second);
+            }
+        }
+    }
+    find_last(m_globs);
+
+    if (best == none)
+    {
+        return Match::None;
+    }
+    return m_patterns[best].negated ? Match::Included : Match::Ignored;
+}
+
+bool
+IgnoreRules::matches(const size_t index,
+                     std::string_view relative,
+                     std::string_view name,
+                     const bool is_dir) const
+{
+    const auto& pattern = m_patterns[index];
+    if (pattern.dir_only && !is_dir)
+    {
+        return false;
+    }
+    return glob_match(pattern.glob, pattern.anchored ? relative : name);
+}
+
+bool
+operator==(const IgnoreRules& l, const IgnoreRules& r)
+{
+    return l.patterns() == r.patterns();
+}
+
+bool
+operator!=(const IgnoreRules& l, const IgnoreRules& r)
+{
+    return !(l == r);
+}
+
+IgnoreResolver::IgnoreResolver(Path root_dir, IgnoreRules rules)
+    : m_root_dir{std::move(root_dir)}
+    , m_rules{std::move(rules)}
+{
+}
+
+bool
+IgnoreResolver::is_ignored(const Path& path, const bool is_dir)
+{
+    const auto full = path.to_narrow();
+    const auto root = m_root_dir.to_narrow();
+    if (full.compare(0, root.size(), root) != 0)
+    {
+        return false;
+    }
+    auto begin = root.size();
+    while (begin < full.size() && is_separator(full[begin]))
+    {
+        ++begin;
+    }
+    const auto relative = std::string_view{full}.substr(begin);
+    // the rules of the dirs on the way along with their offsets
+    std::vector<std::pair<size_t, const IgnoreRules*>> scopes;
+    scopes.emplace_back(0, &rules_of(m_root_dir));
+    size_t offset = 0;
+    while (offset < relative.size())
+    {
+        auto end = offset;
+        while (end < relative.size() && !is_separator(relative[end]))
+        {
+            ++end;
+        }
+        const auto is_parent = end < relative.size();
+        const auto current = relative.substr(0, end);
+        auto match = m_rules.match(current, is_parent || is_dir);
+        for (const auto& [scope, rules] : scopes)
+        {
+            const auto m =
+                rules->match(current.substr(scope), is_parent || is_dir);
+            if (m != IgnoreRules::Match::None)
+            {
+                match = m;
+            }
+        }
+        if (match == IgnoreRules::Match::Ignored)
+        {
+            return true;
+        }
+        if (is_parent)
+        {
+            scopes.emplace_back(
+                end + 1, &rules_of(m_root_dir / Path{std::string{current}}));
+        }
+        offset = end + 1;
+    }
+    return false;
+}
+
+void
+IgnoreResolver::clear()
+{
+    m_dir_rules.clear();
+}
+
+const IgnoreRules&
+IgnoreResolver::rules_of(const Path& dir)
+{
+    auto it = m_dir_rules.find(dir);
+    if (it == m_dir_rules.end())
+    {
+        const auto file = dir / Path{ignore_file_name()};
+        auto rules =
+            file.is_file() ? IgnoreRules::from_file(file) : IgnoreRules{};
+        it = m_dir_rules.emplace(dir, std::move(rules)).first;
+    }
+    return it->second;
+}
+
+bool
+glob_match(std::string_view glob, std::string_view text)
+{
+    size_t g = 0;
+    size_t t = 0;
+    while (g < glob.size())
+    {
+        if (glob[g] == '*')
+        {
+            const auto is_double = g + 1 < glob.size() && glob[g + 1] == '*';
+            const auto rest = glob.substr(g + (is_double ? 2 : 1));
+            if (is_double && !rest.empty() && rest.front() == '/')
+            {
+                // '**/' matches zero or more dirs
+                const auto sub = rest.substr(1);
+                if (glob_match(sub, text.substr(t)))
+                {
+                    return true;
+                }
+                for (auto i = t; i < text.size(); ++i)
+                {
+                    if (is_separator(text[i]) &&
+                        glob_match(sub, text.substr(i + 1)))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            for (auto i = t;; ++i)
+            {
+                if (glob_match(rest, text.substr(i)))
+                {
+                    return true;
+                }
+                if (i == text.size() || (!is_double && is_separator(text[i])))
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (t == text.size())
+        {
+            return false;
+        }
+        const auto c = text[t];
+        if (glob[g] == '?')
+        {
+            if (is_separator(c))
+            {
+                return false;
+            }
+            ++g;
+        }
+        else if (glob[g] == '[')
+        {
+            ++g;
+            if (is_separator(c) || !match_class(glob, g, c))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (glob[g] == '\\' && g + 1 < glob.size())
+            {
+                ++g;
+            }
+            const auto expected = glob[g++];
+            if (expected != c && !(is_separator(expected) && is_separator(c)))
+            {
+                return false;
+            }
+        }
+        ++t;
+    }
+    return t == text.size();
+}
+
+} // namespace vca
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "filesystem.h"
+
+namespace vca
+{
+
+// The name of the per-dir files holding ignore rules
+const std::string&
+ignore_file_name();
+
+// A set of gitignore-style patterns compiled for fast matching. Supported are
+// comments, negation with '!', dir-only patterns with a trailing '/', patterns
+// anchored to the dir of the rules by a leading or inner '/', and the
+// wildcards '*', '?', '[...]' and '**'. As with gitignore, the last matching
+// pattern wins.
+//
+// Plain names and '*.ext' patterns, which make up most real-world rules, are
+// looked up by hash. Only the remaining patterns are matched one by one.
+class IgnoreRules
+{
+public:
+    enum class Match
+    {
+        None,
+        Ignored,
+        Included,
+    };
+
+    IgnoreRules() = default;
+
+    explicit IgnoreRules(std::vector<std::string> patterns);
+
+    // Reads the rules of an ignore file, one pattern per line
+    static IgnoreRules
+    from_file(const Path& file);
+
+    bool
+    empty() const;
+
+    const std::vector<std::string>&
+    patterns() const;
+
+    // relative is the path relative to the dir of these rules
+    Match
+    match(std::string_view relative, bool is_dir) const;
+
+private:
+    struct Pattern
+    {
+        std::string glob;
+        bool negated = false;
+        bool dir_only = false;
+        bool anchored = false;
+    };
+
+    bool
+    matches(size_t index,
+            std::string_view relative,
+            std::string_view name,
+            bool is_dir) const;
+
+    std::vector<std::string> m_sources;
+    std::vector<Pattern> m_patterns;
+    // pattern indices by name and by extension
+    std::unordered_map<std::string, std::vector<size_t>> m_names;
+    std::unordered_map<std::string, std::vector<size_t>> m_extensions;
+    std::vector<size_t> m_globs;
+};
+
+bool
+operator==(const IgnoreRules& l, const IgnoreRules& r);
+
+bool
+operator!=(const IgnoreRules& l, const IgnoreRules& r);
+
+// Tells whether paths below a root dir are ignored by the given rules or the
+// rules of the ignore files in the dirs on the way, in the same way DirWalker
+// prunes them. The ignore files are read once and cached
+class IgnoreResolver
+{
+public:
+    IgnoreResolver(Path root_dir, IgnoreRules rules);
+
+    bool
+    is_ignored(const Path& path, bool is_dir);
+
+    // Drops the cached ignore files, e.g. after one of them changed
+    void
+    clear();
+
+private:
+    const IgnoreRules&
+    rules_of(const Path& dir);
+
+    Path m_root_dir;
+    IgnoreRules m_rules;
+    std::map<Path, IgnoreRules> m_dir_rules;
+};
+
+// Matches text against a glob where '*' and '?' don't match separators but
+// '**' does
+bool
+glob_match(std::string_view glob, std::string_view text);
+
+} // namespace vca
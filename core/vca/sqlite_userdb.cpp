@@ -1,15 +1,21 @@
 #include "sqlite_userdb.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
 #include <list>
+#include <map>
 #include <mutex>
 #include <set>
 #include <sstream>
 
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <SQLiteCpp/VariadicBind.h>
+#include <cryptopp/blake2.h>
 
 #include "filesystem.h"
 #include "logging.h"
+#include "stopwords.h"
 #include "utils.h"
 
 namespace vca
@@ -18,6 +24,31 @@ namespace vca
 namespace
 {
 
+// Bumped whenever the tables change in a way that requires reindexing
+constexpr int g_schema_version = 2;
+
+// Words in more than this percentage of the contents are stored as the
+// contents without them. Stopwords are expected in nearly all text, so they
+// are stored that way earlier. Either goes back below half the percentage
+constexpr int64_t g_common_percent = 60;
+constexpr int64_t g_common_stopword_percent = 30;
+
+// Fewer contents tell little about which words are common
+constexpr int64_t g_min_common_content_count = 64;
+
+// Patterns are lines of ignore files, so they never contain a line feed
+std::string
+join_exclusions(const std::vector<std::string>& exclusions)
+{
+    std::string joined;
+    for (const auto& pattern : exclusions)
+    {
+        joined += pattern;
+        joined += '\n';
+    }
+    return joined;
+}
+
 class SearchCache
 {
 public:
@@ -75,6 +106,48 @@ toSQLiteOpenType(const UserDb::OpenType open_type)
     return SQLite::OPEN_READONLY;
 }
 
+// The smallest string sorting after all strings starting with the given dir
+std::string
+dir_end(std::string dir)
+{
+    ++dir.back(); // the trailing separator
+    return dir;
+}
+
+std::vector<IndexedFile>
+read_files(SQLite::Statement& sel_stm)
+{
+    std::vector<IndexedFile> files;
+    while (sel_stm.executeStep())
+    {
+        const auto blob = sel_stm.getColumn(1);
+        const auto data = static_cast<const unsigned char*>(blob.getBlob());
+        IndexedFile file;
+        file.path = sel_stm.getColumn(0).getText();
+        file.fingerprint =
+            Fingerprint::deserialize({data, data + blob.getBytes()});
+        files.emplace_back(std::move(file));
+    }
+    return files;
+}
+
+// Identifies the text of a file by its words which come sorted
+std::vector<unsigned char>
+text_digest(const FileContents& contents)
+{
+    std::vector<unsigned char> digest(16);
+    CryptoPP::BLAKE2b hash{false, static_cast<unsigned int>(digest.size())};
+    for (size_t i = contents.name_size(); i < contents.size(); ++i)
+    {
+        // including the NUL that separates the words
+        const auto word = contents[i];
+        hash.Update(reinterpret_cast<const unsigned char*>(word.data()),
+                    word.size() + 1);
+    }
+    hash.Final(digest.data());
+    return digest;
+}
+
 } // namespace
 
 struct SqliteUserDb::Impl
@@ -113,6 +186,268 @@ struct SqliteUserDb::Impl
         root_dirs.erase(dir);
     }
 
+    int
+    next_id(const std::string& table)
+    {
+        return db.execAndGet("SELECT IFNULL(MAX(id), -1) + 1 FROM " + table)
+            .getInt();
+    }
+
+    int
+    word_id(const std::string_view word)
+    {
+        SQLite::Statement sel_stm{db, "SELECT id FROM words where word = ?"};
+        sel_stm.bindNoCopy(1, word.data());
+        if (sel_stm.executeStep())
+        {
+            return sel_stm.getColumn(0).getInt();
+        }
+        SQLite::Statement ins_word_stm{
+            db, "INSERT INTO words (id, word) VALUES (?, ?)"};
+        ins_word_stm.bind(1, words_id);
+        ins_word_stm.bindNoCopy(2, word.data());
+        ins_word_stm.exec();
+        return words_id++;
+    }
+
+    // Returns the id of the contents with the text of the given file,
+    // inserting them along with their mappings unless another file has the
+    // same text
+    int
+    text_id(const FileContents& contents)
+    {
+        const auto digest = text_digest(contents);
+
+        SQLite::Statement sel_stm{db,
+                                  "SELECT id FROM contents WHERE digest = ?"};
+        sel_stm.bind(1, digest.data(), static_cast<int>(digest.size()));
+        if (sel_stm.executeStep())
+        {
+            return sel_stm.getColumn(0).getInt();
+        }
+
+        SQLite::Statement ins_stm{
+            db, "INSERT INTO contents (id, digest) VALUES (?, ?)"};
+        ins_stm.bind(1, contents_id);
+        ins_stm.bind(2, digest.data(), static_cast<int>(digest.size()));
+        ins_stm.exec();
+
+        std::set<int> found_common_words;
+        for (size_t i = contents.name_size(); i < contents.size(); ++i)
+        {
+            const auto w_id = word_id(contents[i]);
+            if (common_words.count(w_id) > 0)
+            {
+                found_common_words.insert(w_id);
+                continue;
+            }
+            SQLite::Statement ins_mapping_stm{
+                db,
+                "INSERT INTO mappings (contents_id, words_id) VALUES (?, ?)"};
+            SQLite::bind(ins_mapping_stm, contents_id, w_id);
+            ins_mapping_stm.exec();
+        }
+
+        for (const auto w_id : common_words)
+        {
+            if (found_common_words.count(w_id) > 0)
+            {
+                continue;
+            }
+            SQLite::Statement ins_mapping_stm{db,
+                                              "INSERT INTO common_mappings "
+                                              "(contents_id, words_id) VALUES "
+                                              "(?, ?)"};
+            SQLite::bind(ins_mapping_stm, contents_id, w_id);
+            ins_mapping_stm.exec();
+        }
+
+        return contents_id++;
+    }
+
+    void
+    update_file(const Path& path, const FileContents& contents)
+    {
+        const auto [p, roots_id] = relative(path);
+
+        SQLite::Statement del_stm{
+            db, "DELETE FROM files WHERE path = ? AND roots_id = ?"};
+        SQLite::bind(del_stm, p.to_narrow(), roots_id);
+        del_stm.exec();
+
+        const auto fingerprint = path.fingerprint()->serialize();
+
+        SQLite::Statement ins_stm{db,
+                                  "INSERT INTO files (id, roots_id, "
+                                  "contents_id, path, fingerprint) VALUES "
+                                  "(?, ?, ?, ?, ?)"};
+        SQLite::bind(
+            ins_stm, files_id, roots_id, text_id(contents), p.to_narrow());
+        ins_stm.bind(
+            5, fingerprint.data(), static_cast<int>(fingerprint.size()));
+        ins_stm.exec();
+
+        for (size_t i = 0; i < contents.name_size(); ++i)
+        {
+            SQLite::Statement ins_mapping_stm{
+                db,
+                "INSERT INTO name_mappings (files_id, words_id) VALUES (?, ?)"};
+            SQLite::bind(ins_mapping_stm, files_id, word_id(contents[i]));
+            ins_mapping_stm.exec();
+        }
+
+        ++files_id;
+    }
+
+    // Stores the words in most of the contents as the contents without them
+    // and the other way round once they became rarer again, or too few
+    // contents are left. Only checked after the number of contents changed by
+    // a tenth
+    void
+    update_common_words()
+    {
+        const auto count =
+            db.execAndGet("SELECT COUNT(*) FROM contents").getInt64();
+        const bool enough = count >= g_min_common_content_count;
+        if ((!enough && common_words.empty()) ||
+            std::abs(count - common_content_count) * 10 <
+                common_content_count)
+        {
+            return;
+        }
+        common_content_count = count;
+
+        const auto percent = [](const std::string_view word) {
+            return is_stopword(word) ? g_common_stopword_percent
+                                     : g_common_percent;
+        };
+
+        std::vector<int> added;
+        if (enough)
+        {
+            SQLite::Statement sel_stm{
+                db,
+                "SELECT words_id, word, COUNT(*) FROM mappings JOIN words ON "
+                "words.id = mappings.words_id GROUP BY words_id HAVING "
+                "COUNT(*) * 100 > ? * ?"};
+            SQLite::bind(sel_stm, g_common_stopword_percent, count);
+            while (sel_stm.executeStep())
+            {
+                const auto word_count = sel_stm.getColumn(2).getInt64();
+                if (word_count * 100 >
+                    percent(sel_stm.getColumn(1).getText()) * count)
+                {
+                    added.push_back(sel_stm.getColumn(0).getInt());
+                }
+            }
+        }
+
+        std::vector<int> removed;
+        {
+            SQLite::Statement sel_stm{
+                db,
+                "SELECT words_id, word, (SELECT COUNT(*) FROM common_mappings "
+                "WHERE common_mappings.words_id = common_words.words_id) FROM "
+                "common_words JOIN words ON words.id = common_words.words_id"};
+            while (sel_stm.executeStep())
+            {
+                const auto word_count =
+                    count - sel_stm.getColumn(2).getInt64();
+                if (!enough ||
+                    word_count * 200 <
+                        percent(sel_stm.getColumn(1).getText()) * count)
+                {
+                    removed.push_back(sel_stm.getColumn(0).getInt());
+                }
+            }
+        }
+
+        for (const auto w_id : added)
+        {
+            VCA_DEBUG << __func__ << ": add word " << w_id;
+            SQLite::Statement ins_stm{
+                db,
+                "INSERT INTO common_mappings (contents_id, words_id) SELECT "
+                "id, ?1 FROM contents WHERE NOT EXISTS (SELECT 1 FROM "
+                "mappings WHERE contents_id = contents.id AND words_id = ?1)"};
+            SQLite::Statement ins_word_stm{
+                db, "INSERT INTO common_words (words_id) VALUES (?)"};
+            SQLite::bind(ins_word_stm, w_id);
+            ins_word_stm.exec();
+            SQLite::bind(ins_stm, w_id);
+            ins_stm.exec();
+            common_words.insert(w_id);
+        }
+        if (!added.empty())
+        {
+            // in one pass over the mappings
+            db.exec("DELETE FROM mappings WHERE words_id IN (SELECT words_id "
+                    "FROM common_words)");
+        }
+
+        for (const auto w_id : removed)
+        {
+            VCA_DEBUG << __func__ << ": remove word " << w_id;
+            SQLite::Statement ins_stm{
+                db,
+                "INSERT INTO mappings (contents_id, words_id) SELECT id, ?1 "
+                "FROM contents WHERE NOT EXISTS (SELECT 1 FROM "
+                "common_mappings WHERE contents_id = contents.id AND "
+                "words_id = ?1)"};
+            SQLite::bind(ins_stm, w_id);
+            ins_stm.exec();
+            // cascades to the common mappings
+            SQLite::Statement del_stm{
+                db, "DELETE FROM common_words WHERE words_id = ?"};
+            SQLite::bind(del_stm, w_id);
+            del_stm.exec();
+            common_words.erase(w_id);
+        }
+    }
+
+    void
+    remove_file(const Path& path)
+    {
+        const auto [p, roots_id] = relative(path);
+        SQLite::Statement del_stm{
+            db, "DELETE FROM files WHERE path = ? AND roots_id = ?"};
+        SQLite::bind(del_stm, p.to_narrow(), roots_id);
+        del_stm.exec();
+    }
+
+    // Returns the files with a word of their name or text containing the term
+    std::set<SearchResult>
+    search(const std::string_view term)
+    {
+        SQLite::Statement query_stm{
+            db,
+            "SELECT dir, path FROM files JOIN roots ON roots.id = "
+            "files.roots_id JOIN mappings ON files.contents_id = "
+            "mappings.contents_id JOIN words ON mappings.words_id = words.id "
+            "WHERE words.word LIKE ?1 UNION "
+            "SELECT dir, path FROM files JOIN roots ON roots.id = "
+            "files.roots_id JOIN name_mappings ON files.id = "
+            "name_mappings.files_id JOIN words ON name_mappings.words_id = "
+            "words.id WHERE words.word LIKE ?1 UNION "
+            "SELECT dir, path FROM files JOIN roots ON roots.id = "
+            "files.roots_id JOIN common_words JOIN words ON "
+            "common_words.words_id = words.id WHERE words.word LIKE ?1 AND NOT "
+            "EXISTS (SELECT 1 FROM common_mappings WHERE "
+            "common_mappings.contents_id = files.contents_id AND "
+            "common_mappings.words_id = common_words.words_id)"};
+        SQLite::bind(query_stm, "%" + std::string{term} + "%");
+        std::set<SearchResult> results;
+        while (query_stm.executeStep())
+        {
+            const Path root_dir{query_stm.getColumn(0).getText()};
+            const Path path{query_stm.getColumn(1).getText()};
+            const auto p = root_dir / path;
+            results.insert(
+                {p.parent(), p.filename(), p.extension().to_narrow()});
+        }
+        return results;
+    }
+
     std::pair<Path, int>
     relative(const Path& p) const
     {
@@ -128,6 +463,11 @@ struct SqliteUserDb::Impl
     }
 
     SearchCache cache;
+    // the words stored as the contents without them
+    std::set<int> common_words;
+    // the number of contents when the common words were last checked
+    int64_t common_content_count = 0;
+    int contents_id = 0;
     int files_id = 0;
     int words_id = 0;
     Path path;
@@ -161,36 +501,185 @@ SqliteUserDb::create(const std::set<Path>& root_dirs)
     m_impl->cache.clear();
     SQLite::Transaction transaction{m_impl->db};
 
+    // an index of an older schema is dropped and built from scratch
+    const auto version = m_impl->db.execAndGet("PRAGMA user_version").getInt();
+    if (version != g_schema_version)
+    {
+        VCA_INFO << "Drop user db of schema version " << version;
+        for (const auto table : {"common_mappings",
+                                 "common_words",
+                                 "name_mappings",
+                                 "mappings",
+                                 "files",
+                                 "contents",
+                                 "words",
+                                 "scans",
+                                 "dirs",
+                                 "roots"})
+        {
+            m_impl->db.exec(std::string{"DROP TABLE IF EXISTS "} + table);
+        }
+        m_impl->db.exec("PRAGMA user_version = " +
+                        std::to_string(g_schema_version));
+    }
+
     m_impl->db.exec("CREATE TABLE IF NOT EXISTS roots ("
                     "id INTEGER PRIMARY KEY,"
                     "dir TEXT NOT NULL UNIQUE)");
 
+    // the text of files by the digest of its words, shared by all files
+    // with the same text
+    m_impl->db.exec("CREATE TABLE IF NOT EXISTS contents ("
+                    "id INTEGER PRIMARY KEY,"
+                    "digest BLOB NOT NULL UNIQUE)");
+
     m_impl->db.exec(
         "CREATE TABLE IF NOT EXISTS files ("
         "id INTEGER PRIMARY KEY,"
         "roots_id INTEGER NOT NULL,"
+        "contents_id INTEGER NOT NULL,"
         "path TEXT NOT NULL, "
         "fingerprint BLOB NOT NULL, "
-        "FOREIGN KEY (roots_id) REFERENCES roots (id) ON DELETE CASCADE)");
+        "FOREIGN KEY (roots_id) REFERENCES roots (id) ON DELETE CASCADE,"
+        "FOREIGN KEY (contents_id) REFERENCES contents (id))");
 
     m_impl->db.exec("CREATE TABLE IF NOT EXISTS words ("
                     "id INTEGER PRIMARY KEY, "
                     "word TEXT NOT NULL)");
 
+    // the words of the text of files
     m_impl->db.exec(
         "CREATE TABLE IF NOT EXISTS mappings ("
+        "contents_id INTEGER NOT NULL,"
+        "words_id INTEGER NOT NULL,"
+        "FOREIGN KEY (contents_id) REFERENCES contents (id) ON DELETE CASCADE,"
+        "FOREIGN KEY (words_id) REFERENCES words (id) ON DELETE CASCADE)");
+
+    // the words in most of the contents
+    m_impl->db.exec(
+        "CREATE TABLE IF NOT EXISTS common_words ("
+        "words_id INTEGER PRIMARY KEY,"
+        "FOREIGN KEY (words_id) REFERENCES words (id) ON DELETE CASCADE)");
+
+    // the contents without a common word
+    m_impl->db.exec(
+        "CREATE TABLE IF NOT EXISTS common_mappings ("
+        "contents_id INTEGER NOT NULL,"
+        "words_id INTEGER NOT NULL,"
+        "PRIMARY KEY (contents_id, words_id),"
+        "FOREIGN KEY (contents_id) REFERENCES contents (id) ON DELETE CASCADE,"
+        "FOREIGN KEY (words_id) REFERENCES common_words (words_id) "
+        "ON DELETE CASCADE)");
+
+    // the words of the names of files
+    m_impl->db.exec(
+        "CREATE TABLE IF NOT EXISTS name_mappings ("
         "files_id INTEGER NOT NULL,"
         "words_id INTEGER NOT NULL,"
         "FOREIGN KEY (files_id) REFERENCES files (id) ON DELETE CASCADE,"
         "FOREIGN KEY (words_id) REFERENCES words (id) ON DELETE CASCADE)");
 
-    // keep the words
-    m_impl->db.exec("DELETE FROM roots");
+    // checkpoints stored without their exclusions are dropped, the scans
+    // start over but the files indexed are kept
+    if (m_impl->db.tableExists("scans"))
+    {
+        bool has_exclusions = false;
+        {
+            SQLite::Statement sel_stm{
+                m_impl->db,
+                "SELECT 1 FROM pragma_table_info('scans') "
+                "WHERE name = 'exclusions'"};
+            has_exclusions = sel_stm.executeStep();
+        }
+        if (!has_exclusions)
+        {
+            m_impl->db.exec("DROP TABLE scans");
+        }
+    }
+
+    m_impl->db.exec(
+        "CREATE TABLE IF NOT EXISTS scans ("
+        "roots_id INTEGER PRIMARY KEY,"
+        "checkpoint TEXT NOT NULL,"
+        "exclusions TEXT NOT NULL,"
+        "FOREIGN KEY (roots_id) REFERENCES roots (id) ON DELETE CASCADE)");
+
+    m_impl->db.exec(
+        "CREATE TABLE IF NOT EXISTS dirs ("
+        "roots_id INTEGER NOT NULL,"
+        "path TEXT NOT NULL,"
+        "mtime INTEGER NOT NULL,"
+        "PRIMARY KEY (roots_id, path),"
+        "FOREIGN KEY (roots_id) REFERENCES roots (id) ON DELETE CASCADE)");
+
+    // for paging through a root dir in path order
+    m_impl->db.exec("CREATE INDEX IF NOT EXISTS files_roots_id_path ON files "
+                    "(roots_id, path)");
+
+    // for cascading file and contents deletes
+    m_impl->db.exec("CREATE INDEX IF NOT EXISTS name_mappings_files_id ON "
+                    "name_mappings (files_id)");
+    // also for finding the contents without a word becoming common
+    m_impl->db.exec("CREATE INDEX IF NOT EXISTS mappings_contents_id ON "
+                    "mappings (contents_id, words_id)");
+    m_impl->db.exec("CREATE INDEX IF NOT EXISTS files_contents_id ON files "
+                    "(contents_id)");
+
+    // the contents go along with the last file referencing them, also when
+    // a delete cascades from the root dir
+    m_impl->db.exec(
+        "CREATE TRIGGER IF NOT EXISTS files_delete_contents AFTER DELETE ON "
+        "files WHEN NOT EXISTS (SELECT 1 FROM files WHERE contents_id = "
+        "OLD.contents_id) BEGIN DELETE FROM contents WHERE id = "
+        "OLD.contents_id; END");
+
+    // keep the index of root dirs that are still configured so that the
+    // scanner only needs to reconcile it with what's on disk
     m_impl->root_dirs.clear();
+    std::set<Path> stale_dirs;
+    {
+        SQLite::Statement sel_stm{m_impl->db, "SELECT id, dir FROM roots"};
+        while (sel_stm.executeStep())
+        {
+            const auto id = sel_stm.getColumn(0).getInt();
+            Path dir{sel_stm.getColumn(1).getText()};
+            if (root_dirs.count(dir) > 0)
+            {
+                m_impl->root_dirs.emplace(std::move(dir), id);
+            }
+            else
+            {
+                stale_dirs.emplace(std::move(dir));
+            }
+        }
+    }
+    for (const auto& dir : stale_dirs)
+    {
+        m_impl->remove_root_dir(dir);
+    }
+
+    m_impl->common_words.clear();
+    m_impl->common_content_count = 0;
+    {
+        SQLite::Statement sel_stm{m_impl->db,
+                                  "SELECT words_id FROM common_words"};
+        while (sel_stm.executeStep())
+        {
+            m_impl->common_words.insert(sel_stm.getColumn(0).getInt());
+        }
+    }
+
+    m_impl->roots_id = m_impl->next_id("roots");
+    m_impl->contents_id = m_impl->next_id("contents");
+    m_impl->files_id = m_impl->next_id("files");
+    m_impl->words_id = m_impl->next_id("words");
 
     for (const auto& dir : root_dirs)
     {
-        m_impl->add_root_dir(dir);
+        if (m_impl->root_dirs.count(dir) == 0)
+        {
+            m_impl->add_root_dir(dir);
+        }
     }
 
     transaction.commit();
@@ -230,51 +719,8 @@ SqliteUserDb::update_file(const Path& path, const FileContents& contents)
     m_impl->last_file_update = std::chrono::system_clock::now();
     VCA_DEBUG << __func__ << ": " << path;
     m_impl->cache.clear();
-    const auto [p, roots_id] = m_impl->relative(path);
     SQLite::Transaction transaction{m_impl->db};
-
-    SQLite::Statement del_stm{
-        m_impl->db, "DELETE FROM files WHERE path = ? AND roots_id = ?"};
-    SQLite::bind(del_stm, p.to_narrow(), roots_id);
-    del_stm.exec();
-
-    const auto fingerprint = path.fingerprint()->serialize();
-
-    SQLite::Statement ins_stm{m_impl->db,
-                              "INSERT INTO files (id, roots_id, path, "
-                              "fingerprint) VALUES (?, ?, ?, ?)"};
-    SQLite::bind(ins_stm, m_impl->files_id, roots_id, p.to_narrow());
-    ins_stm.bind(4, fingerprint.data(), static_cast<int>(fingerprint.size()));
-    ins_stm.exec();
-
-    for (const auto& word : contents.words)
-    {
-        SQLite::Statement sel_stm{m_impl->db,
-                                  "SELECT id FROM words where word = ?"};
-        SQLite::bind(sel_stm, word);
-        int words_id;
-        if (sel_stm.executeStep())
-        {
-            words_id = sel_stm.getColumn(0).getInt();
-        }
-        else
-        {
-            words_id = m_impl->words_id;
-            ++m_impl->words_id;
-            SQLite::Statement ins_word_stm{
-                m_impl->db, "INSERT INTO words (id, word) VALUES (?, ?)"};
-            SQLite::bind(ins_word_stm, words_id, word);
-            ins_word_stm.exec();
-        }
-
-        SQLite::Statement ins_mapping_stm{
-            m_impl->db,
-            "INSERT INTO mappings (files_id, words_id) VALUES (?, ?)"};
-        SQLite::bind(ins_mapping_stm, m_impl->files_id, words_id);
-        ins_mapping_stm.exec();
-    }
-
-    ++m_impl->files_id;
+    m_impl->update_file(path, contents);
     transaction.commit();
 }
 
@@ -284,11 +730,8 @@ SqliteUserDb::remove_file(const Path& path)
     m_impl->last_file_update = std::chrono::system_clock::now();
     VCA_DEBUG << __func__ << ": " << path;
     m_impl->cache.clear();
-    const auto [p, roots_id] = m_impl->relative(path);
     SQLite::Transaction transaction{m_impl->db};
-    SQLite::Statement del_stm{m_impl->db, "DELETE FROM files WHERE path = ?"};
-    SQLite::bind(del_stm, p.to_narrow());
-    del_stm.exec();
+    m_impl->remove_file(path);
     transaction.commit();
 }
 
@@ -310,6 +753,187 @@ SqliteUserDb::move_file(const Path& old_path, const Path& path)
     transaction.commit();
 }
 
+std::vector<IndexedFile>
+SqliteUserDb::list_files(const Path& root_dir,
+                         const std::string& from,
+                         const size_t max_count) const
+{
+    const auto root = m_impl->root_dirs.find(root_dir);
+    if (root == m_impl->root_dirs.end())
+    {
+        return {};
+    }
+
+    SQLite::Statement sel_stm{
+        m_impl->db,
+        "SELECT path, fingerprint FROM files WHERE roots_id = ? AND path >= ? "
+        "ORDER BY path LIMIT ?"};
+    SQLite::bind(sel_stm, root->second, from, static_cast<int>(max_count));
+    return read_files(sel_stm);
+}
+
+std::vector<IndexedFile>
+SqliteUserDb::list_dir_files(const Path& root_dir, const std::string& dir) const
+{
+    const auto root = m_impl->root_dirs.find(root_dir);
+    if (root == m_impl->root_dirs.end())
+    {
+        return {};
+    }
+
+    // the files of the subtree whose remaining path has no separator. No
+    // UTF-8 path starts with 0xff which bounds the subtree of the root dir
+    const std::string separator(
+        1, static_cast<char>(std::filesystem::path::preferred_separator));
+    SQLite::Statement sel_stm{
+        m_impl->db,
+        "SELECT path, fingerprint FROM files WHERE roots_id = ? AND path >= ? "
+        "AND path < ? AND instr(substr(path, ?), ?) = 0 ORDER BY path"};
+    SQLite::bind(sel_stm,
+                 root->second,
+                 dir,
+                 dir.empty() ? std::string{"\xff"} : dir_end(dir),
+                 static_cast<int>(dir.size() + 1),
+                 separator);
+    return read_files(sel_stm);
+}
+
+std::map<std::string, uint64_t>
+SqliteUserDb::list_dirs(const Path& root_dir) const
+{
+    const auto root = m_impl->root_dirs.find(root_dir);
+    if (root == m_impl->root_dirs.end())
+    {
+        return {};
+    }
+
+    SQLite::Statement sel_stm{
+        m_impl->db, "SELECT path, mtime FROM dirs WHERE roots_id = ?"};
+    SQLite::bind(sel_stm, root->second);
+    std::map<std::string, uint64_t> dirs;
+    while (sel_stm.executeStep())
+    {
+        dirs.emplace(sel_stm.getColumn(0).getText(),
+                     static_cast<uint64_t>(sel_stm.getColumn(1).getInt64()));
+    }
+    return dirs;
+}
+
+void
+SqliteUserDb::commit_poll(const Path& root_dir, const PollBatch& batch)
+{
+    m_impl->last_file_update = std::chrono::system_clock::now();
+    VCA_DEBUG << __func__ << ": " << root_dir << " - "
+              << batch.updated_files.size() << " updated, "
+              << batch.removed_files.size() << " removed, "
+              << batch.removed_dirs.size() << " dirs removed";
+    m_impl->cache.clear();
+    const auto root = m_impl->root_dirs.find(root_dir);
+    VCA_CHECK(root != m_impl->root_dirs.end())
+        << "Unknown root_dir: " << root_dir;
+    SQLite::Transaction transaction{m_impl->db};
+
+    for (const auto& dir : batch.removed_dirs)
+    {
+        for (const auto table : {"files", "dirs"})
+        {
+            SQLite::Statement del_stm{m_impl->db,
+                                      std::string{"DELETE FROM "} + table +
+                                          " WHERE roots_id = ? AND path >= ? "
+                                          "AND path < ?"};
+            SQLite::bind(del_stm, root->second, dir, dir_end(dir));
+            del_stm.exec();
+        }
+    }
+    for (const auto& [path, contents] : batch.updated_files)
+    {
+        m_impl->update_file(path, contents);
+    }
+    for (const auto& path : batch.removed_files)
+    {
+        m_impl->remove_file(path);
+    }
+    m_impl->update_common_words();
+    for (const auto& [dir, mtime] : batch.updated_dirs)
+    {
+        SQLite::Statement ins_stm{m_impl->db,
+                                  "INSERT OR REPLACE INTO dirs (roots_id, "
+                                  "path, mtime) VALUES (?, ?, ?)"};
+        SQLite::bind(
+            ins_stm, root->second, dir, static_cast<int64_t>(mtime));
+        ins_stm.exec();
+    }
+
+    transaction.commit();
+}
+
+std::string
+SqliteUserDb::scan_checkpoint(const Path& root_dir,
+                              const std::vector<std::string>& exclusions) const
+{
+    const auto root = m_impl->root_dirs.find(root_dir);
+    if (root == m_impl->root_dirs.end())
+    {
+        return {};
+    }
+    SQLite::Statement sel_stm{
+        m_impl->db,
+        "SELECT checkpoint, exclusions FROM scans WHERE roots_id = ?"};
+    SQLite::bind(sel_stm, root->second);
+    // the files excluded meanwhile may be in the part already scanned
+    if (sel_stm.executeStep() &&
+        sel_stm.getColumn(1).getText() == join_exclusions(exclusions))
+    {
+        return sel_stm.getColumn(0).getText();
+    }
+    return {};
+}
+
+void
+SqliteUserDb::commit_scan(const Path& root_dir, const ScanBatch& batch)
+{
+    m_impl->last_file_update = std::chrono::system_clock::now();
+    VCA_DEBUG << __func__ << ": " << root_dir << " - "
+              << batch.updated_files.size() << " updated, "
+              << batch.removed_files.size() << " removed";
+    m_impl->cache.clear();
+    const auto root = m_impl->root_dirs.find(root_dir);
+    VCA_CHECK(root != m_impl->root_dirs.end())
+        << "Unknown root_dir: " << root_dir;
+    SQLite::Transaction transaction{m_impl->db};
+
+    for (const auto& [path, contents] : batch.updated_files)
+    {
+        m_impl->update_file(path, contents);
+    }
+    for (const auto& path : batch.removed_files)
+    {
+        m_impl->remove_file(path);
+    }
+    m_impl->update_common_words();
+
+    if (batch.checkpoint.empty())
+    {
+        SQLite::Statement del_stm{m_impl->db,
+                                  "DELETE FROM scans WHERE roots_id = ?"};
+        SQLite::bind(del_stm, root->second);
+        del_stm.exec();
+    }
+    else
+    {
+        SQLite::Statement ins_stm{m_impl->db,
+                                  "INSERT OR REPLACE INTO scans (roots_id, "
+                                  "checkpoint, exclusions) VALUES (?, ?, ?)"};
+        SQLite::bind(ins_stm,
+                     root->second,
+                     batch.checkpoint,
+                     join_exclusions(batch.exclusions));
+        ins_stm.exec();
+    }
+
+    transaction.commit();
+}
+
 std::vector<SearchResult>
 SqliteUserDb::search(const FileContents& contents) const
 {
@@ -320,24 +944,38 @@ SqliteUserDb::search(const FileContents& contents) const
     }
 
     std::map<SearchResult, size_t> results_map;
-    for (const auto& word : contents.words)
+    for (const auto word : contents)
     {
         VCA_DEBUG << __func__ << ": " << word;
-        SQLite::Statement query_stm{
-            m_impl->db,
-            "SELECT dir, path FROM files JOIN roots ON roots.id = "
-            "files.roots_id JOIN mappings ON files.id = mappings.files_id "
-            "JOIN words ON mappings.words_id = words.id "
-            "WHERE words.word LIKE ?"};
-        SQLite::bind(query_stm, "%" + word + "%");
-        while (query_stm.executeStep())
+        // the files matching all terms of the word
+        std::set<SearchResult> matches;
+        bool first_term = true;
+        for (const auto term : search_terms(word))
         {
-            const Path root_dir{query_stm.getColumn(0).getText()};
-            const Path path{query_stm.getColumn(1).getText()};
-            const auto p = root_dir / path;
-            SearchResult result{
-                p.parent(), p.filename(), p.extension().to_narrow()};
-            results_map[std::move(result)]++;
+            auto term_matches = m_impl->search(term);
+            if (first_term)
+            {
+                matches = std::move(term_matches);
+                first_term = false;
+            }
+            else
+            {
+                std::set<SearchResult> both;
+                std::set_intersection(matches.begin(),
+                                      matches.end(),
+                                      term_matches.begin(),
+                                      term_matches.end(),
+                                      std::inserter(both, both.end()));
+                matches = std::move(both);
+            }
+            if (matches.empty())
+            {
+                break;
+            }
+        }
+        for (const auto& match : matches)
+        {
+            results_map[match]++;
         }
     }
 
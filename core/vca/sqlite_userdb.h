@@ -39,6 +39,28 @@ public:
     void
     move_file(const Path& old_path, const Path& path) override;
 
+    std::vector<IndexedFile>
+    list_files(const Path& root_dir,
+               const std::string& from,
+               size_t max_count) const override;
+
+    std::string
+    scan_checkpoint(const Path& root_dir,
+                    const std::vector<std::string>& exclusions) const override;
+
+    void
+    commit_scan(const Path& root_dir, const ScanBatch& batch) override;
+
+    std::vector<IndexedFile>
+    list_dir_files(const Path& root_dir,
+                   const std::string& dir) const override;
+
+    std::map<std::string, uint64_t>
+    list_dirs(const Path& root_dir) const override;
+
+    void
+    commit_poll(const Path& root_dir, const PollBatch& batch) override;
+
     std::vector<SearchResult>
     search(const FileContents& contents) const override;
 
@@ -0,0 +1,89 @@
+#include "stopwords.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace vca
+{
+
+namespace
+{
+
+// Separated by spaces
+constexpr std::string_view g_english =
+    "the and of to in is it that for was on are with as be at by this have "
+    "from or an not but were which you he she they we his her its their has "
+    "had been would there can all if so no do";
+
+constexpr std::string_view g_german =
+    "der die das und ist nicht ein eine einen dem den des zu mit sich auf für "
+    "von im sie es auch als an werden wird aus er hat dass bei oder wie nach "
+    "noch sind wir ich zum zur vom";
+
+constexpr std::string_view g_french =
+    "le la les de des du un une et est en que qui dans pour pas sur au aux ce "
+    "il elle ne se par plus avec sont ou son sa ses nous vous ils été";
+
+constexpr std::string_view g_spanish =
+    "el la los las de del que en un una es por con para se no lo al su sus "
+    "como más pero fue ha este esta";
+
+constexpr std::string_view g_italian =
+    "il lo la gli le di del della che un una in per con non si da al alla sono "
+    "come ma nel nella";
+
+constexpr std::string_view g_dutch =
+    "de het een en van is dat op te in niet met zijn voor die er aan ook als "
+    "bij door maar om dan naar";
+
+constexpr std::string_view g_portuguese =
+    "os as de do da dos das que em um uma para com não por no na se mais ao "
+    "foi como";
+
+// No stopword is longer
+constexpr size_t g_max_stopword_size = 8;
+
+const std::unordered_set<std::string_view>&
+stopwords()
+{
+    static const auto words = [] {
+        std::unordered_set<std::string_view> words;
+        const auto add = [&words](std::string_view language) {
+            while (!language.empty())
+            {
+                const auto end = std::min(language.find(' '), language.size());
+                words.insert(language.substr(0, end));
+                language.remove_prefix(std::min(end + 1, language.size()));
+            }
+        };
+        add(g_english);
+        add(g_german);
+        add(g_french);
+        add(g_spanish);
+        add(g_italian);
+        add(g_dutch);
+        add(g_portuguese);
+        return words;
+    }();
+    return words;
+}
+
+} // namespace
+
+bool
+is_stopword(const std::string_view word)
+{
+    if (word.size() > g_max_stopword_size)
+    {
+        return false;
+    }
+    char lower[g_max_stopword_size];
+    for (size_t i = 0; i < word.size(); ++i)
+    {
+        const auto c = word[i];
+        lower[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return stopwords().count({lower, word.size()}) > 0;
+}
+
+} // namespace vca
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+
+namespace vca
+{
+
+// Checks whether word is one of the most frequent function words of English,
+// German, French, Spanish, Italian, Dutch or Portuguese, ignoring the case of
+// ASCII letters
+bool
+is_stopword(std::string_view word);
+
+} // namespace vca
@@ -1,9 +1,26 @@
 #include "string.h"
 
 #include <algorithm>
+#include <array>
+#include <iterator>
 #include <codecvt>
 #include <map>
-#include <unordered_set>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VCA_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define VCA_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#if defined(VCA_SIMD_SSE2) || defined(VCA_SIMD_NEON)
+#define VCA_SIMD
+#endif
 
 #ifdef VCA_PLATFORM_WINDOWS
 #pragma warning(push)
@@ -11,10 +28,6 @@
 #pragma warning(disable : 4459)
 #endif
 #include <boost/algorithm/string.hpp>
-#include <boost/spirit/include/qi_char_class.hpp>
-#include <boost/spirit/include/qi_numeric.hpp>
-#include <boost/spirit/include/qi_operator.hpp>
-#include <boost/spirit/include/qi_parse.hpp>
 #ifdef VCA_PLATFORM_WINDOWS
 #pragma warning(pop)
 #endif
@@ -28,9 +41,641 @@ namespace
 {
 
 constexpr size_t g_max_word_length = 32;
+constexpr size_t g_max_carry_size = 65536;
+constexpr size_t g_arena_block_size = 16384;
+// e.g. "&#x10ffff;"
+constexpr size_t g_max_entity_length = 10;
+constexpr size_t g_max_tag_name_length = 16;
+
+// the names of the html entities for U+00A0 to U+00FF
+using namespace std::string_view_literals;
+constexpr std::string_view g_latin1_entities[]{
+    "nbsp"sv,   "iexcl"sv,  "cent"sv,   "pound"sv,  "curren"sv, "yen"sv,
+    "brvbar"sv, "sect"sv,   "uml"sv,    "copy"sv,   "ordf"sv,   "laquo"sv,
+    "not"sv,    "shy"sv,    "reg"sv,    "macr"sv,   "deg"sv,    "plusmn"sv,
+    "sup2"sv,   "sup3"sv,   "acute"sv,  "micro"sv,  "para"sv,   "middot"sv,
+    "cedil"sv,  "sup1"sv,   "ordm"sv,   "raquo"sv,  "frac14"sv, "frac12"sv,
+    "frac34"sv, "iquest"sv, "Agrave"sv, "Aacute"sv, "Acirc"sv,  "Atilde"sv,
+    "Auml"sv,   "Aring"sv,  "AElig"sv,  "Ccedil"sv, "Egrave"sv, "Eacute"sv,
+    "Ecirc"sv,  "Euml"sv,   "Igrave"sv, "Iacute"sv, "Icirc"sv,  "Iuml"sv,
+    "ETH"sv,    "Ntilde"sv, "Ograve"sv, "Oacute"sv, "Ocirc"sv,  "Otilde"sv,
+    "Ouml"sv,   "times"sv,  "Oslash"sv, "Ugrave"sv, "Uacute"sv, "Ucirc"sv,
+    "Uuml"sv,   "Yacute"sv, "THORN"sv,  "szlig"sv,  "agrave"sv, "aacute"sv,
+    "acirc"sv,  "atilde"sv, "auml"sv,   "aring"sv,  "aelig"sv,  "ccedil"sv,
+    "egrave"sv, "eacute"sv, "ecirc"sv,  "euml"sv,   "igrave"sv, "iacute"sv,
+    "icirc"sv,  "iuml"sv,   "eth"sv,    "ntilde"sv, "ograve"sv, "oacute"sv,
+    "ocirc"sv,  "otilde"sv, "ouml"sv,   "divide"sv, "oslash"sv, "ugrave"sv,
+    "uacute"sv, "ucirc"sv,  "uuml"sv,   "yacute"sv, "thorn"sv,  "yuml"sv};
+constexpr Char g_first_latin1_entity = 0xa0;
+static_assert(std::size(g_latin1_entities) == 0x100 - g_first_latin1_entity);
+
+bool
+is_blank(const char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Unlike std::isalnum, independent of the locale and inlined
+bool
+is_ascii_alnum(const char c)
+{
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+char
+to_ascii_lower(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+}
+
+// Returns the char of an html latin-1 entity name, or 0 if there is none
+Char
+find_latin1_entity(const std::string_view name)
+{
+    using Entity = std::pair<std::string_view, Char>;
+    static const auto entities = [] {
+        std::array<Entity, std::size(g_latin1_entities)> sorted;
+        for (size_t i = 0; i < sorted.size(); ++i)
+        {
+            sorted[i] = {g_latin1_entities[i],
+                         g_first_latin1_entity + static_cast<Char>(i)};
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    }();
+    const auto it = std::lower_bound(
+        entities.begin(),
+        entities.end(),
+        name,
+        [](const Entity& e, const std::string_view n) { return e.first < n; });
+    return it != entities.end() && it->first == name ? it->second : 0;
+}
+
+// Returns the length of the longest prefix of text ending with a complete
+// line, or with a complete word if there is no such line. Lines ending with a
+// hyphen, possibly followed by blanks, are incomplete as they are joined with
+// the next one
+size_t
+token_boundary(const std::string_view text)
+{
+    for (auto i = text.size(); i > 0; --i)
+    {
+        if (text[i - 1] != '\n')
+        {
+            continue;
+        }
+        auto last = i - 1;
+        while (last > 0 &&
+               (is_blank(text[last - 1]) || text[last - 1] == '\r' ||
+                text[last - 1] == '\n'))
+        {
+            --last;
+        }
+        if (last == 0 || text[last - 1] != '-')
+        {
+            return i;
+        }
+    }
+    const auto space = text.find_last_of(" \t");
+    return space == std::string_view::npos ? 0 : space + 1;
+}
+
+// Returns the length of the longest prefix of text not ending within a
+// multi-byte sequence
+size_t
+utf8_boundary(const std::string_view text)
+{
+    auto i = text.size();
+    while (i > 0 && (static_cast<unsigned char>(text[i - 1]) & 0xc0) == 0x80)
+    {
+        --i;
+    }
+    return i > 0 && static_cast<unsigned char>(text[i - 1]) >= 0xc0
+        ? i - 1
+        : text.size();
+}
+
+#if defined(VCA_SIMD)
+
+// Returns the index of the lowest set bit of a non-zero mask
+size_t
+lowest_bit(const uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+// A bit for each byte of a vector of 16
+struct ChunkMasks
+{
+    uint32_t non_ascii;
+    // the ASCII chars separating words, i.e. the spaces, the end of line chars
+    // and the printable chars other than letters and digits
+    uint32_t separators;
+};
 
+ChunkMasks
+classify_chunk(const char* const data)
+{
+#if defined(VCA_SIMD_SSE2)
+    const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    // the bytes not ASCII are negative and thus in none of the ranges
+    const auto in_range = [](const __m128i c, const char lo, const char hi) {
+        return _mm_and_si128(
+            _mm_cmpgt_epi8(c, _mm_set1_epi8(static_cast<char>(lo - 1))),
+            _mm_cmplt_epi8(c, _mm_set1_epi8(static_cast<char>(hi + 1))));
+    };
+    // either case of a letter
+    const auto letter =
+        in_range(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+    const auto alnum = _mm_or_si128(letter, in_range(chunk, '0', '9'));
+    const auto separators =
+        _mm_or_si128(in_range(chunk, '\t', '\r'),
+                     _mm_andnot_si128(alnum, in_range(chunk, ' ', '~')));
+    return {static_cast<uint32_t>(_mm_movemask_epi8(chunk)),
+            static_cast<uint32_t>(_mm_movemask_epi8(separators))};
+#else
+    const auto chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(data));
+    const auto in_range = [](const uint8x16_t c,
+                             const uint8_t lo,
+                             const uint8_t hi) {
+        return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)),
+                        vcleq_u8(c, vdupq_n_u8(hi)));
+    };
+    // there is no movemask, so each byte keeps its own bit and they are added
+    const auto to_mask = [](const uint8x16_t matches) {
+        static const uint8_t bits[16]{
+            1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const auto masked = vandq_u8(matches, vld1q_u8(bits));
+        return static_cast<uint32_t>(vaddv_u8(vget_low_u8(masked))) |
+            static_cast<uint32_t>(vaddv_u8(vget_high_u8(masked))) << 8;
+    };
+    const auto letter = in_range(vorrq_u8(chunk, vdupq_n_u8(0x20)), 'a', 'z');
+    const auto alnum = vorrq_u8(letter, in_range(chunk, '0', '9'));
+    const auto separators =
+        vorrq_u8(in_range(chunk, '\t', '\r'),
+                 vbicq_u8(in_range(chunk, ' ', '~'), alnum));
+    return {to_mask(vcgeq_u8(chunk, vdupq_n_u8(0x80))), to_mask(separators)};
+#endif
+}
+
+#endif
+
+// Decodes the sequence starting at index i of str into c and returns its
+// length, or zero if it is malformed or truncated
+size_t
+decode_utf8(const std::string_view str, const size_t i, Char& c)
+{
+    const auto lead = static_cast<unsigned char>(str[i]);
+    size_t length;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    if (lead < 0x80)
+    {
+        c = lead;
+        return 1;
+    }
+    else if (lead >= 0xc2 && lead <= 0xdf)
+    {
+        length = 2;
+        c = lead & 0x1f;
+    }
+    else if (lead >= 0xe0 && lead <= 0xef)
+    {
+        length = 3;
+        c = lead & 0x0f;
+        lo = lead == 0xe0 ? 0xa0 : lo;
+        hi = lead == 0xed ? 0x9f : hi;
+    }
+    else if (lead >= 0xf0 && lead <= 0xf4)
+    {
+        length = 4;
+        c = lead & 0x07;
+        lo = lead == 0xf0 ? 0x90 : lo;
+        hi = lead == 0xf4 ? 0x8f : hi;
+    }
+    else
+    {
+        return 0;
+    }
+    if (i + length > str.size())
+    {
+        return 0;
+    }
+    for (size_t j = 1; j < length; ++j)
+    {
+        const auto next = static_cast<unsigned char>(str[i + j]);
+        if (next < lo || next > hi)
+        {
+            return 0;
+        }
+        c = (c << 6) | (next & 0x3f);
+        lo = 0x80;
+        hi = 0xbf;
+    }
+    return length;
 }
 
+// Checks whether c is the first byte of one of the end of line chars
+bool
+may_end_line(const char c)
+{
+    return (c >= '\n' && c <= '\r') || c == '\xc2' || c == '\xe2';
+}
+
+// Returns the length of the line break starting at index i of text, or zero
+// if there is none
+size_t
+end_of_line_length(const std::string_view text, const size_t i)
+{
+    switch (text[i])
+    {
+    case '\n':
+    case '\v':
+    case '\f':
+    case '\r':
+        return 1;
+    case '\xc2':
+        return text.compare(i, 2, "\xc2\x85") == 0 ? 2 : 0; // U+0085
+    case '\xe2':
+        return text.compare(i, 3, "\xe2\x80\xa8") == 0 || // U+2028
+                text.compare(i, 3, "\xe2\x80\xa9") == 0   // U+2029
+            ? 3
+            : 0;
+    default:
+        return 0;
+    }
+}
+
+// Calls on_word with each word of the UTF-8 text, its length in chars and
+// whether it is ASCII. Runs of CJK chars are passed to on_cjk as overlapping
+// bigrams, a single CJK char on its own, unless on_cjk is nullptr. Malformed
+// sequences separate words like spaces. ASCII chars are classified 16 at a
+// time with SIMD where available
+template <typename WordFunction, typename CjkFunction>
+void
+for_each_word(const std::string_view text,
+              WordFunction&& on_word,
+              CjkFunction&& on_cjk)
+{
+    constexpr bool split_cjk =
+        !std::is_same_v<std::decay_t<CjkFunction>, std::nullptr_t>;
+    const auto& separators = separator_chars();
+    size_t start = 0;
+    size_t length = 0;
+    bool ascii = true;
+    const auto end_word = [&](const size_t end) {
+        if (length > 0)
+        {
+            on_word(text.substr(start, end - start), length, ascii);
+        }
+        length = 0;
+        ascii = true;
+    };
+    const auto add_char = [&](const size_t i) {
+        if (length++ == 0)
+        {
+            start = i;
+        }
+    };
+#if defined(VCA_SIMD)
+    // adds the ASCII chars from first to last
+    const auto add_chars = [&](const size_t first, const size_t last) {
+        if (first < last)
+        {
+            if (length == 0)
+            {
+                start = first;
+            }
+            length += last - first;
+        }
+    };
+#endif
+    // the last CJK char of the current run and the length of the run
+    size_t cjk_start = 0;
+    size_t cjk_end = 0;
+    size_t cjk_length = 0;
+    const auto end_cjk = [&] {
+        if constexpr (split_cjk)
+        {
+            if (cjk_length == 1)
+            {
+                on_cjk(text.substr(cjk_start, cjk_end - cjk_start));
+            }
+        }
+        cjk_length = 0;
+    };
+
+    size_t i = 0;
+    while (i < text.size())
+    {
+        if (static_cast<unsigned char>(text[i]) < 0x80)
+        {
+            end_cjk();
+#if defined(VCA_SIMD)
+            // up to the next non-ASCII byte, the chars between separators are
+            // added as a whole
+            while (i + 16 <= text.size())
+            {
+                const auto masks = classify_chunk(text.data() + i);
+                const auto count = masks.non_ascii == 0
+                    ? size_t{16}
+                    : lowest_bit(masks.non_ascii);
+                auto mask = masks.separators & ((1u << count) - 1);
+                auto run_start = i;
+                while (mask != 0)
+                {
+                    const auto separator = i + lowest_bit(mask);
+                    add_chars(run_start, separator);
+                    end_word(separator);
+                    run_start = separator + 1;
+                    mask &= mask - 1;
+                }
+                add_chars(run_start, i + count);
+                i += count;
+                if (count < 16)
+                {
+                    break;
+                }
+            }
+#endif
+            for (; i < text.size() &&
+                 static_cast<unsigned char>(text[i]) < 0x80;
+                 ++i)
+            {
+                if (separators.contains(static_cast<unsigned char>(text[i])))
+                {
+                    end_word(i);
+                }
+                else
+                {
+                    add_char(i);
+                }
+            }
+            if (i == text.size())
+            {
+                break;
+            }
+        }
+
+        Char c;
+        const auto count = decode_utf8(text, i, c);
+        if (count == 0)
+        {
+            end_word(i);
+            end_cjk();
+            ++i;
+            continue;
+        }
+        if (separators.contains(c))
+        {
+            end_word(i);
+            end_cjk();
+        }
+        else if (split_cjk && is_cjk(c))
+        {
+            end_word(i);
+            if constexpr (split_cjk)
+            {
+                if (cjk_length > 0)
+                {
+                    on_cjk(text.substr(cjk_start, i + count - cjk_start));
+                }
+            }
+            cjk_start = i;
+            cjk_end = i + count;
+            ++cjk_length;
+        }
+        else
+        {
+            end_cjk();
+            add_char(i);
+            ascii = false;
+        }
+        i += count;
+    }
+    end_word(text.size());
+    end_cjk();
+}
+
+// Checks whether str is a floating point number, i.e. an optionally signed
+// decimal with an optional exponent, nan or inf(inity), optionally followed
+// by whitespace
+template <typename CharT>
+bool
+is_number(const std::basic_string_view<CharT> str)
+{
+    size_t i = 0;
+    const auto skip_if = [&str, &i](const auto predicate) {
+        const auto start = i;
+        while (i < str.size() && predicate(str[i]))
+        {
+            ++i;
+        }
+        return i - start;
+    };
+    const auto skip_digits = [&skip_if] {
+        return skip_if([](const CharT c) { return c >= '0' && c <= '9'; });
+    };
+    const auto skip_sign = [&str, &i] {
+        if (i < str.size() && (str[i] == '+' || str[i] == '-'))
+        {
+            ++i;
+        }
+    };
+    const auto skip_word = [&str, &i](const std::string_view word) {
+        // ignoring case, i.e. the 0x20 bit of letters
+        for (size_t j = 0; j < word.size(); ++j)
+        {
+            const auto letter = static_cast<CharT>(word[j]);
+            if (i + j == str.size() ||
+                static_cast<CharT>(str[i + j] | 0x20) != letter)
+            {
+                return false;
+            }
+        }
+        i += word.size();
+        return true;
+    };
+
+    skip_sign();
+    if (!skip_word("nan") && !skip_word("infinity") && !skip_word("inf"))
+    {
+        auto digit_count = skip_digits();
+        if (i < str.size() && str[i] == '.')
+        {
+            ++i;
+            digit_count += skip_digits();
+        }
+        if (digit_count == 0)
+        {
+            return false;
+        }
+        if (i < str.size() && (str[i] == 'e' || str[i] == 'E'))
+        {
+            const auto mantissa_end = i++;
+            skip_sign();
+            if (skip_digits() == 0)
+            {
+                i = mantissa_end;
+            }
+        }
+    }
+    skip_if([](const CharT c) { return c == ' ' || (c >= '\t' && c <= '\r'); });
+    return i == str.size();
+}
+
+// Returns the index of the first a or b in text at or after pos, or npos.
+// Compares 16 bytes at a time with SIMD where available
+size_t
+find_either(const std::string_view text, size_t pos, const char a, const char b)
+{
+#if defined(VCA_SIMD_SSE2)
+    const auto a_chunk = _mm_set1_epi8(a);
+    const auto b_chunk = _mm_set1_epi8(b);
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const auto data = reinterpret_cast<const __m128i*>(text.data() + pos);
+        const auto chunk = _mm_loadu_si128(data);
+        const auto mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(chunk, a_chunk), _mm_cmpeq_epi8(chunk, b_chunk)));
+        if (mask != 0)
+        {
+            return pos + lowest_bit(static_cast<uint32_t>(mask));
+        }
+    }
+#elif defined(VCA_SIMD_NEON)
+    const auto a_chunk = vdupq_n_u8(static_cast<uint8_t>(a));
+    const auto b_chunk = vdupq_n_u8(static_cast<uint8_t>(b));
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const auto chunk =
+            vld1q_u8(reinterpret_cast<const uint8_t*>(text.data() + pos));
+        const auto matches =
+            vorrq_u8(vceqq_u8(chunk, a_chunk), vceqq_u8(chunk, b_chunk));
+        if (vmaxvq_u8(matches) != 0)
+        {
+            break;
+        }
+    }
+#endif
+    for (; pos < text.size(); ++pos)
+    {
+        if (text[pos] == a || text[pos] == b)
+        {
+            return pos;
+        }
+    }
+    return std::string_view::npos;
+}
+
+void
+append_utf8(std::string& str, const Char c)
+{
+    if (c < 0x80)
+    {
+        str += static_cast<char>(c);
+    }
+    else if (c < 0x800)
+    {
+        str += static_cast<char>(0xc0 | (c >> 6));
+        str += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+        str += static_cast<char>(0xe0 | (c >> 12));
+        str += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        str += static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else
+    {
+        str += static_cast<char>(0xf0 | (c >> 18));
+        str += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+        str += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        str += static_cast<char>(0x80 | (c & 0x3f));
+    }
+}
+
+// Decodes the numeric entity, or the xml or html latin-1 named entity, text
+// starts with into decoded as UTF-8 and returns its length, or zero if text
+// does not start with such an entity
+size_t
+decode_entity(const std::string_view text, std::string& decoded)
+{
+    static constexpr std::pair<std::string_view, std::string_view> named[]{
+        {"&amp;", "&"},
+        {"&lt;", "<"},
+        {"&gt;", ">"},
+        {"&quot;", "\""},
+        {"&apos;", "'"}};
+    const auto end = text.substr(0, g_max_entity_length).find(';');
+    if (text.size() < 3 || text[0] != '&' || end == std::string_view::npos)
+    {
+        return 0;
+    }
+    decoded.clear();
+    if (text[1] != '#')
+    {
+        for (const auto& [entity, chars] : named)
+        {
+            if (text.substr(0, end + 1) == entity)
+            {
+                decoded = chars;
+                return entity.size();
+            }
+        }
+        const auto c = find_latin1_entity(text.substr(1, end - 1));
+        if (c == 0)
+        {
+            return 0;
+        }
+        append_utf8(decoded, c);
+        return end + 1;
+    }
+
+    const auto hex = text[2] == 'x' || text[2] == 'X';
+    const auto digits = text.substr(hex ? 3 : 2, end - (hex ? 3 : 2));
+    if (digits.empty())
+    {
+        return 0;
+    }
+    Char c = 0;
+    for (const auto d : digits)
+    {
+        Char value;
+        if (d >= '0' && d <= '9')
+        {
+            value = static_cast<Char>(d - '0');
+        }
+        else if (hex && (d | 0x20) >= 'a' && (d | 0x20) <= 'f')
+        {
+            value = static_cast<Char>((d | 0x20) - 'a' + 10);
+        }
+        else
+        {
+            return 0;
+        }
+        c = c * (hex ? 16 : 10) + value;
+        if (c > 0x10ffff)
+        {
+            return 0;
+        }
+    }
+    if (c == 0 || (c >= 0xd800 && c <= 0xdfff))
+    {
+        return 0;
+    }
+    append_utf8(decoded, c);
+    return end + 1;
+}
+
+} // namespace
+
 #if defined(VCA_PLATFORM_WINDOWS) && _MSC_VER < 2000
 
 String
@@ -68,10 +713,130 @@ wide_to_narrow(const String& wide)
 
 #endif
 
-const std::unordered_set<Char>&
+bool
+is_valid_utf8(const std::string_view str, const bool truncated)
+{
+    size_t i = 0;
+    while (i < str.size())
+    {
+        const auto c = static_cast<unsigned char>(str[i]);
+        if (c < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        size_t length;
+        // the valid range of the second byte, excluding overlong forms,
+        // surrogates and code points beyond U+10FFFF
+        unsigned char lo = 0x80;
+        unsigned char hi = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf)
+        {
+            length = 2;
+        }
+        else if (c >= 0xe0 && c <= 0xef)
+        {
+            length = 3;
+            if (c == 0xe0)
+            {
+                lo = 0xa0;
+            }
+            else if (c == 0xed)
+            {
+                hi = 0x9f;
+            }
+        }
+        else if (c >= 0xf0 && c <= 0xf4)
+        {
+            length = 4;
+            if (c == 0xf0)
+            {
+                lo = 0x90;
+            }
+            else if (c == 0xf4)
+            {
+                hi = 0x8f;
+            }
+        }
+        else
+        {
+            return false;
+        }
+        for (size_t j = 1; j < length; ++j)
+        {
+            if (i + j == str.size())
+            {
+                return truncated;
+            }
+            const auto next = static_cast<unsigned char>(str[i + j]);
+            if (next < lo || next > hi)
+            {
+                return false;
+            }
+            lo = 0x80;
+            hi = 0xbf;
+        }
+        i += length;
+    }
+    return true;
+}
+
+CharClass::CharClass(const std::initializer_list<Char> chars)
+{
+    std::vector<Char> others;
+    for (const auto c : chars)
+    {
+        if (c < m_ascii.size())
+        {
+            m_ascii.set(c);
+        }
+        else
+        {
+            others.push_back(c);
+        }
+    }
+    std::sort(others.begin(), others.end());
+    for (const auto c : others)
+    {
+        add_range({c, c});
+    }
+}
+
+CharClass
+CharClass::operator|(const CharClass& other) const
+{
+    std::vector<std::pair<Char, Char>> ranges;
+    std::merge(m_ranges.begin(),
+               m_ranges.end(),
+               other.m_ranges.begin(),
+               other.m_ranges.end(),
+               std::back_inserter(ranges));
+    CharClass result;
+    result.m_ascii = m_ascii | other.m_ascii;
+    for (const auto& range : ranges)
+    {
+        result.add_range(range);
+    }
+    return result;
+}
+
+void
+CharClass::add_range(const std::pair<Char, Char>& range)
+{
+    if (!m_ranges.empty() && range.first <= m_ranges.back().second + 1)
+    {
+        m_ranges.back().second = std::max(m_ranges.back().second, range.second);
+    }
+    else
+    {
+        m_ranges.push_back(range);
+    }
+}
+
+const CharClass&
 special_chars()
 {
-    static const std::unordered_set<Char> specials{
+    static const CharClass specials{
         U'\x3001', U'\xff1f', U'\xff09', U'\x2026', U'\xff08', U'\x3002',
         U'\xff0c', U'\x9',    U'\x3e',   U'\x3c',   U'\x2019', U'\x27',
         U'\x22',   U'\x7c',   U'\x3d',   U'\x201d', U'\x2b',   U'\x201c',
@@ -83,14 +848,43 @@ special_chars()
     return specials;
 }
 
-const std::unordered_set<Char>&
+const CharClass&
 end_of_line_chars()
 {
-    static const std::unordered_set<Char> eols{
+    static const CharClass eols{
         U'\xa', U'\xb', U'\xc', U'\xd', U'\x85', U'\x2028', U'\x2029'};
     return eols;
 }
 
+const CharClass&
+space_chars()
+{
+    static const CharClass spaces{U'\x20',
+                                  U'\xa0',
+                                  U'\x2000',
+                                  U'\x2001',
+                                  U'\x2002',
+                                  U'\x2003',
+                                  U'\x2004',
+                                  U'\x2005',
+                                  U'\x2006',
+                                  U'\x2007',
+                                  U'\x2009',
+                                  U'\x200a',
+                                  U'\x202f',
+                                  U'\x205f',
+                                  U'\x3000'};
+    return spaces;
+}
+
+const CharClass&
+separator_chars()
+{
+    static const auto separators =
+        special_chars() | end_of_line_chars() | space_chars();
+    return separators;
+}
+
 Char
 line_feed_char()
 {
@@ -106,48 +900,33 @@ space_char()
 void
 to_lower_case(String& str)
 {
-    const auto& u2l = upper_to_lower_map();
-    std::transform(str.begin(), str.end(), str.begin(), [&u2l](const Char c) {
-        const auto it = u2l.find(c);
-        if (it != u2l.end())
-        {
-            return it->second;
-        }
-        return c;
-    });
+    std::transform(str.begin(), str.end(), str.begin(), lower_case);
 }
 
 void
 to_upper_case(String& str)
 {
-    const auto& l2u = lower_to_upper_map();
-    std::transform(str.begin(), str.end(), str.begin(), [&l2u](const Char c) {
-        const auto it = l2u.find(c);
-        if (it != l2u.end())
-        {
-            return it->second;
-        }
-        return c;
-    });
+    std::transform(str.begin(), str.end(), str.begin(), upper_case);
 }
 
 bool
 is_numeric(const String& str)
 {
-    typename String::const_iterator first(str.begin()), last(str.end());
-    return boost::spirit::qi::parse(first,
-                                    last,
-                                    boost::spirit::double_ >>
-                                        *boost::spirit::qi::space) &&
-        first == last;
+    return is_number(std::u32string_view{str});
+}
+
+bool
+is_numeric(const std::string_view str)
+{
+    return is_number(str);
 }
 
 void
-replace_all(String& str, const std::unordered_set<Char>& chars, Char with)
+replace_all(String& str, const CharClass& chars, Char with)
 {
     for (auto& c : str)
     {
-        if (chars.count(c) > 0)
+        if (chars.contains(c))
         {
             c = with;
         }
@@ -185,124 +964,373 @@ xml_unescape(String& text)
     }
 }
 
-XMLParser::XMLParser(const std::string& content)
-    : m_content{content}
+void
+xml_unescape(std::string& text)
 {
+    auto i = text.find('&');
+    if (i == std::string::npos)
+    {
+        return;
+    }
+    // unescape in place in a single pass so "&amp;lt;" stays "&lt;", an
+    // entity is never shorter than its UTF-8
+    std::string decoded;
+    auto out = i;
+    while (i < text.size())
+    {
+        const auto count = text[i] == '&'
+            ? decode_entity(std::string_view{text}.substr(i), decoded)
+            : 0;
+        if (count > 0)
+        {
+            text.replace(out, decoded.size(), decoded);
+            out += decoded.size();
+            i += count;
+        }
+        else
+        {
+            text[out++] = text[i++];
+        }
+    }
+    text.resize(out);
 }
 
-bool
-XMLParser::end() const
+std::string_view
+StringArena::store(const std::string_view str)
 {
-    return static_cast<size_t>(m_index + 1) >= m_content.size();
+    if (m_blocks.empty() ||
+        m_blocks.back().capacity() - m_blocks.back().size() < str.size())
+    {
+        // never grow a block, that would move the strings stored
+        std::string block;
+        block.reserve(std::max(g_arena_block_size, str.size()));
+        m_blocks.push_back(std::move(block));
+    }
+    auto& block = m_blocks.back();
+    const auto offset = block.size();
+    block.append(str.data(), str.size());
+    return std::string_view{block}.substr(offset);
 }
 
-String
-XMLParser::next()
+void
+StringArena::clear()
 {
-    constexpr char start_tag = '>';
-    constexpr char end_tag = '<';
-    int start_index = -1;
-    int end_index = -1;
-    while (!end())
+    if (m_blocks.size() > 1)
     {
-        if (m_content[m_index] == start_tag)
-        {
-            start_index = m_index + 1;
-        }
-        else if (start_index >= 0 && m_content[m_index] == end_tag)
-        {
-            end_index = m_index - 1;
-            break;
-        }
-        ++m_index;
+        m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
     }
-    if (start_index >= end_index)
+    if (!m_blocks.empty())
     {
-        return {};
+        m_blocks.front().clear();
     }
-    const auto text = m_content.substr(start_index, end_index - start_index);
-    vca::String wide_text;
-    try
+}
+
+void
+TokenCounter::push(const std::string_view token)
+{
+    const auto position = m_position++;
+    const auto stats = m_stats.find(token);
+    if (stats != m_stats.end())
+    {
+        ++stats->second.frequency;
+        return;
+    }
+    m_stats.emplace(m_arena.store(token), Stats{1, position});
+}
+
+std::vector<Term>
+TokenCounter::terms(const bool sorted) const
+{
+    std::vector<Term> terms;
+    terms.reserve(m_stats.size());
+    for (const auto& [term, stats] : m_stats)
     {
-        wide_text = narrow_to_wide(text);
+        terms.push_back({term, stats.frequency, stats.first_position});
     }
-    catch (const std::range_error&)
+    if (sorted)
     {
-        // return empty string if conversion failed (i.e. if binary data)
-        return wide_text;
+        std::sort(terms.begin(), terms.end(), [](const auto& l, const auto& r) {
+            return l.term < r.term;
+        });
     }
-    xml_unescape(wide_text);
-    return wide_text;
+    return terms;
 }
 
-String
-xml_tag_content(const std::string& content, const size_t max_byte_count)
+void
+TokenCounter::clear()
 {
-    XMLParser parser{content};
+    m_stats.clear();
+    m_arena.clear();
+    m_position = 0;
+}
 
-    String one_line;
-    size_t byte_count = 0;
-    while (!parser.end() && byte_count < max_byte_count)
-    {
-        auto line = parser.next();
-        trim(line);
-        if (line.empty())
+void
+tokenize(const std::string_view text, TokenSink& sink)
+{
+    const auto push_word = [&sink](const std::string_view word,
+                                   const size_t length,
+                                   const bool ascii) {
+        if (length <= 1 || length > g_max_word_length)
         {
-            continue;
+            return;
         }
-        byte_count += line.size() * 4;
-        if (line.back() == U'-')
+        if (ascii && is_numeric(word))
         {
-            one_line.insert(one_line.end(), line.begin(), line.end() - 1);
+            return;
         }
-        else
+        sink.push(word);
+    };
+    const auto push_cjk = [&sink](const std::string_view c) { sink.push(c); };
+    for_each_word(text, push_word, push_cjk);
+}
+
+void
+split_words(const std::string_view text, TokenSink& sink)
+{
+    const auto push_word = [&sink](const std::string_view word, size_t, bool) {
+        sink.push(word);
+    };
+    for_each_word(text, push_word, nullptr);
+}
+
+TokenWriter::TokenWriter(TokenSink& sink, const bool xml_unescape)
+    : m_sink{sink}
+    , m_xml_unescape{xml_unescape}
+{
+}
+
+void
+TokenWriter::write(const std::string_view text)
+{
+    m_carry.append(text.data(), text.size());
+    auto end = token_boundary(m_carry);
+    if (end == 0)
+    {
+        if (m_carry.size() < g_max_carry_size)
         {
-            one_line += line + U" ";
+            return;
         }
+        // a single overlong word, cut it off
+        end = utf8_boundary(m_carry);
     }
-
-    xml_unescape(one_line);
-    return one_line;
+    tokenize_text(std::string_view{m_carry}.substr(0, end));
+    m_carry.erase(0, end);
 }
 
-std::vector<String>
-tokenize(String line)
+void
+TokenWriter::flush()
 {
-    replace_all(line, special_chars(), space_char());
-    replace_all(line, end_of_line_chars(), space_char());
+    tokenize_text(m_carry);
+    m_carry.clear();
+}
 
-    std::vector<String> words;
-    for (auto& c : line)
+void
+TokenWriter::tokenize_text(const std::string_view text)
+{
+    // join the lines, lines ending with a hyphen without a space
+    m_text.clear();
+    size_t i = 0;
+    while (i < text.size())
     {
-        if (is_cjk(c))
+        // copy up to the next char that may start a line break at once
+        const auto start = i;
+        while (i < text.size() && !may_end_line(text[i]))
+        {
+            ++i;
+        }
+        m_text.append(text.data() + start, i - start);
+        if (i == text.size())
         {
-            words.emplace_back(String{1, c});
-            c = space_char();
+            break;
+        }
+        auto count = end_of_line_length(text, i);
+        if (count == 0)
+        {
+            m_text += text[i++];
+            continue;
+        }
+        // a run of line breaks ends a single line
+        while (count > 0)
+        {
+            i += count;
+            count = i < text.size() ? end_of_line_length(text, i) : 0;
+        }
+        while (!m_text.empty() && is_blank(m_text.back()))
+        {
+            m_text.pop_back();
+        }
+        if (!m_text.empty() && m_text.back() == '-')
+        {
+            m_text.pop_back();
+        }
+        else
+        {
+            m_text += ' ';
         }
     }
 
-    std::list<String> tokens;
-    split(tokens, line, space_char());
+    if (m_xml_unescape)
+    {
+        xml_unescape(m_text);
+    }
+    tokenize(m_text, m_sink);
+}
+
+XmlTextWriter::XmlTextWriter(TokenSink& sink, const bool html)
+    : m_writer{sink}
+    , m_html{html}
+{
+}
 
-    for (auto& t : tokens)
+void
+XmlTextWriter::write(const std::string_view xml)
+{
+    // the text of all nodes is tokenized at once
+    m_text.clear();
+    extract_text(xml);
+    m_writer.write(m_text);
+}
+
+void
+XmlTextWriter::extract_text(const std::string_view xml)
+{
+    size_t i = 0;
+    while (i < xml.size())
     {
-        trim(t);
-        if (t.size() <= 1)
+        switch (m_state)
         {
-            continue;
+        case State::Text:
+        {
+            const auto end = find_either(xml, i, '<', '&');
+            m_text.append(xml.substr(i, end - i));
+            if (end == std::string_view::npos)
+            {
+                return;
+            }
+            if (xml[end] == '<')
+            {
+                // a text node ends a line, and empty ones add no more
+                if (m_text.empty() || m_text.back() != '\n')
+                {
+                    m_text += '\n';
+                }
+                // only the script and style tags of html are told apart
+                m_tag_name.clear();
+                m_state = m_html ? State::TagName : State::Tag;
+            }
+            else
+            {
+                // only entities cut off by the chunk end are read char by char
+                const auto count = decode_entity(xml.substr(end), m_decoded);
+                if (count > 0)
+                {
+                    m_text += m_decoded;
+                    i = end + count;
+                    break;
+                }
+                m_entity.assign(1, '&');
+                m_state = State::Entity;
+            }
+            i = end + 1;
+            break;
         }
-        if (t.size() > g_max_word_length)
+        case State::Entity:
         {
-            continue;
+            const auto c = xml[i];
+            if (c == ';')
+            {
+                m_entity += c;
+                ++i;
+            }
+            else if (m_entity.size() < g_max_entity_length &&
+                     (is_ascii_alnum(c) || c == '#'))
+            {
+                m_entity += c;
+                ++i;
+                break;
+            }
+            // the entity is complete or not an entity at all
+            if (decode_entity(m_entity, m_decoded) == m_entity.size())
+            {
+                m_text += m_decoded;
+            }
+            else
+            {
+                m_text += m_entity;
+            }
+            m_state = State::Text;
+            break;
         }
-        if (is_numeric(t))
+        case State::TagName:
         {
-            continue;
+            while (i < xml.size() &&
+                   m_tag_name.size() < g_max_tag_name_length &&
+                   (is_ascii_alnum(xml[i]) || xml[i] == '/'))
+            {
+                m_tag_name += to_ascii_lower(xml[i++]);
+            }
+            if (i == xml.size())
+            {
+                return;
+            }
+            if (!m_raw_text_tag.empty())
+            {
+                // only the end tag ends the raw text of a script or style
+                const auto is_end_tag = m_tag_name.size() > 1 &&
+                    m_tag_name[0] == '/' &&
+                    m_tag_name.compare(1, std::string::npos, m_raw_text_tag) ==
+                        0;
+                if (!is_end_tag)
+                {
+                    m_state = State::RawText;
+                    break;
+                }
+                m_raw_text_tag.clear();
+            }
+            else if (m_html &&
+                     (m_tag_name == "script" || m_tag_name == "style"))
+            {
+                m_raw_text_tag = m_tag_name;
+            }
+            m_state = State::Tag;
+            break;
+        }
+        case State::Tag:
+        {
+            const auto end = xml.find('>', i);
+            if (end == std::string_view::npos)
+            {
+                return;
+            }
+            m_state = m_raw_text_tag.empty() ? State::Text : State::RawText;
+            i = end + 1;
+            break;
+        }
+        case State::RawText:
+        {
+            const auto end = xml.find('<', i);
+            if (end == std::string_view::npos)
+            {
+                return;
+            }
+            m_tag_name.clear();
+            m_state = State::TagName;
+            i = end + 1;
+            break;
+        }
         }
-        words.emplace_back(std::move(t));
     }
+}
 
-    return words;
+void
+XmlTextWriter::flush()
+{
+    if (m_state == State::Entity)
+    {
+        m_writer.write(m_entity);
+        m_state = State::Text;
+    }
+    m_writer.flush();
 }
 
 bool
@@ -312,15 +1340,86 @@ is_cjk(const Char c)
     {
         return true;
     }
+    if (c >= 0x3400 && c <= 0x4dbf) // chinese extension A
+    {
+        return true;
+    }
     if (c >= 0x3040 && c <= 0x30ff) // japanese
     {
         return true;
     }
+    if (c >= 0xff66 && c <= 0xff9f) // halfwidth katakana
+    {
+        return true;
+    }
     if (c >= 0xac00 && c <= 0xd7a3) // korean
     {
         return true;
     }
+    if (c >= 0xffa1 && c <= 0xffdc) // halfwidth hangul
+    {
+        return true;
+    }
     return false;
 }
 
+std::vector<std::string_view>
+search_terms(const std::string_view word)
+{
+    std::vector<std::string_view> terms;
+    const auto add_words = [&terms](const std::string_view text) {
+        const auto push_word = [&terms](const std::string_view w,
+                                        size_t,
+                                        bool) { terms.push_back(w); };
+        for_each_word(text, push_word, nullptr);
+    };
+    // the text since the last CJK char
+    size_t text_start = 0;
+    // the last CJK char of the current run and the length of the run
+    size_t cjk_start = 0;
+    size_t cjk_length = 0;
+    size_t i = 0;
+    while (i < word.size())
+    {
+        Char c;
+        const auto count = decode_utf8(word, i, c);
+        if (count == 0 || !is_cjk(c))
+        {
+            if (cjk_length == 1)
+            {
+                terms.push_back(word.substr(cjk_start, i - cjk_start));
+            }
+            cjk_length = 0;
+            i += std::max<size_t>(count, 1);
+            continue;
+        }
+        if (cjk_length == 0 && i > text_start)
+        {
+            add_words(word.substr(text_start, i - text_start));
+        }
+        else if (cjk_length > 0)
+        {
+            terms.push_back(word.substr(cjk_start, i + count - cjk_start));
+        }
+        cjk_start = i;
+        ++cjk_length;
+        i += count;
+        text_start = i;
+    }
+    if (cjk_length == 1)
+    {
+        terms.push_back(word.substr(cjk_start));
+    }
+    else if (text_start == 0)
+    {
+        // a word without CJK text is matched as is
+        terms.push_back(word);
+    }
+    else if (cjk_length == 0)
+    {
+        add_words(word.substr(text_start));
+    }
+    return terms;
+}
+
 } // namespace vca
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <bitset>
+#include <initializer_list>
+#include <iterator>
 #include <list>
 #include <string>
-#include <unordered_set>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "utils.h"
+
 namespace vca
 {
 
@@ -17,12 +24,62 @@ narrow_to_wide(const std::string& narrow);
 std::string
 wide_to_narrow(const String& wide);
 
-const std::unordered_set<Char>&
+// Checks for well-formed UTF-8. A truncated str may end in the middle of a
+// sequence, e.g. when only the start of a file was read
+bool
+is_valid_utf8(std::string_view str, bool truncated = false);
+
+// A set of chars stored as a bitmap for ASCII and as sorted, disjoint ranges
+// for the rest
+class CharClass
+{
+public:
+    CharClass() = default;
+
+    CharClass(std::initializer_list<Char> chars);
+
+    bool
+    contains(const Char c) const
+    {
+        if (c < m_ascii.size())
+        {
+            return m_ascii[c];
+        }
+        const auto range = std::upper_bound(
+            m_ranges.begin(),
+            m_ranges.end(),
+            c,
+            [](const Char c, const auto& range) { return c < range.first; });
+        return range != m_ranges.begin() && c <= std::prev(range)->second;
+    }
+
+    // Returns the union of both classes
+    CharClass
+    operator|(const CharClass& other) const;
+
+private:
+    // Appends a range not starting before the last one
+    void
+    add_range(const std::pair<Char, Char>& range);
+
+    std::bitset<128> m_ascii;
+    std::vector<std::pair<Char, Char>> m_ranges;
+};
+
+const CharClass&
 special_chars();
 
-const std::unordered_set<Char>&
+const CharClass&
 end_of_line_chars();
 
+// Space and the Unicode space separators
+const CharClass&
+space_chars();
+
+// Special, end of line and space chars, which separate words
+const CharClass&
+separator_chars();
+
 Char
 line_feed_char();
 
@@ -38,8 +95,11 @@ to_upper_case(String& str);
 bool
 is_numeric(const String& str);
 
+bool
+is_numeric(std::string_view str);
+
 void
-replace_all(String& str, const std::unordered_set<Char>& chars, Char with);
+replace_all(String& str, const CharClass& chars, Char with);
 
 void
 split(std::list<String>& vec, const String& str, Char delimiter);
@@ -50,29 +110,173 @@ trim(String& str);
 void
 xml_unescape(String& text);
 
-class XMLParser
+// Decodes the predefined, html latin-1 and numeric entities in a single pass
+void
+xml_unescape(std::string& text);
+
+// Receives the tokens of a document in UTF-8 as they are extracted. A token
+// is only valid during the call
+class TokenSink
+{
+public:
+    virtual ~TokenSink() = default;
+
+    virtual void
+    push(std::string_view token) = 0;
+};
+
+// Stores copies of strings in large blocks so storing one rarely allocates.
+// The views returned stay valid until the arena is cleared or destroyed
+class StringArena
 {
 public:
-    explicit XMLParser(const std::string& content);
+    StringArena() = default;
+
+    VCA_DELETE_COPY(StringArena)
+    VCA_DEFAULT_MOVE(StringArena)
+
+    std::string_view
+    store(std::string_view str);
+
+    // Drops all strings stored but keeps the first block for reuse
+    void
+    clear();
+
+private:
+    std::vector<std::string> m_blocks;
+};
+
+// A distinct token of a document
+struct Term
+{
+    std::string_view term;
+    // the number of occurrences
+    size_t frequency;
+    // the position of the first occurrence counted in tokens
+    size_t first_position;
 
     bool
-    end() const;
+    operator==(const Term& o) const
+    {
+        return term == o.term && frequency == o.frequency &&
+            first_position == o.first_position;
+    }
+};
+
+// Collects the distinct tokens pushed along with their frequencies and first
+// positions. Only the first occurrence of a token is copied, into an arena.
+// Meant to be reused for many documents
+class TokenCounter : public TokenSink
+{
+public:
+    TokenCounter() = default;
+
+    VCA_DELETE_COPY(TokenCounter)
+    VCA_DEFAULT_MOVE(TokenCounter)
+
+    void
+    push(std::string_view token) override;
+
+    // The terms are valid until the counter is cleared. They are sorted by
+    // term if requested and in no particular order otherwise
+    std::vector<Term>
+    terms(bool sorted = false) const;
 
-    String
-    next();
+    // Keeps the memory allocated for the next document
+    void
+    clear();
 
 private:
-    const std::string& m_content;
-    int m_index = 0;
+    struct Stats
+    {
+        size_t frequency;
+        size_t first_position;
+    };
+
+    StringArena m_arena;
+    std::unordered_map<std::string_view, Stats> m_stats;
+    size_t m_position = 0;
 };
 
-String
-xml_tag_content(const std::string& content, size_t max_byte_count);
+// Pushes the words of UTF-8 text that are 2 to 32 chars long and not numeric
+// as well as each CJK char. Malformed sequences separate words
+void
+tokenize(std::string_view text, TokenSink& sink);
+
+// Pushes all words of UTF-8 text, e.g. of a file name
+void
+split_words(std::string_view text, TokenSink& sink);
+
+// Tokenizes UTF-8 text written in chunks of any size. Words and lines joined
+// by a hyphen that are cut off at the end of a chunk are carried over to the
+// next one so memory use is bounded by the chunk size, not the text size
+class TokenWriter
+{
+public:
+    explicit TokenWriter(TokenSink& sink, bool xml_unescape = false);
 
-std::vector<String>
-tokenize(String line);
+    void
+    write(std::string_view text);
+
+    // Tokenizes the text carried over, e.g. at the end of the text
+    void
+    flush();
+
+private:
+    void
+    tokenize_text(std::string_view text);
+
+    TokenSink& m_sink;
+    bool m_xml_unescape;
+    std::string m_carry;
+    std::string m_text;
+};
+
+// Tokenizes the text between the tags of XML or HTML written in chunks of any
+// size, e.g. as it is inflated. Entities are decoded and each text node ends a
+// line. For HTML the contents of script and style elements are skipped
+class XmlTextWriter
+{
+public:
+    explicit XmlTextWriter(TokenSink& sink, bool html = false);
+
+    void
+    write(std::string_view xml);
+
+    void
+    flush();
+
+private:
+    enum class State
+    {
+        Text,
+        Entity,
+        TagName,
+        Tag,
+        RawText,
+    };
+
+    void
+    extract_text(std::string_view xml);
+
+    TokenWriter m_writer;
+    bool m_html;
+    State m_state = State::Text;
+    std::string m_text;
+    std::string m_entity;
+    std::string m_decoded;
+    std::string m_tag_name;
+    // the element whose contents are skipped, if any
+    std::string m_raw_text_tag;
+};
 
 bool
 is_cjk(Char c);
 
+// Splits a search word into the terms the words of a file must all contain to
+// match it: the bigrams indexed for its CJK runs, a single CJK char on its
+// own, and the words between them. Words without CJK text are kept as is
+std::vector<std::string_view>
+search_terms(std::string_view word);
+
 } // namespace vca
@@ -1,5 +1,7 @@
 #include "userdb.h"
 
+#include <algorithm>
+
 namespace vca
 {
 
@@ -12,12 +14,28 @@ FileContents::fromSearch(std::list<String> values)
     }
     values.remove_if([](const auto& v) { return v.empty(); });
     vca::FileContents file_contents;
-    file_contents.words.reserve(values.size());
     for (const auto& v : values)
     {
-        file_contents.words.emplace_back(vca::wide_to_narrow(v));
+        file_contents.add(vca::wide_to_narrow(v));
     }
     return file_contents;
 }
 
+void
+FileContents::add(const std::string_view word,
+                  const size_t frequency,
+                  const size_t first_position)
+{
+    VCA_CHECK(m_buffer.size() + word.size() < UINT32_MAX)
+        << "File contents too large";
+    const auto saturate = [](const size_t n) {
+        return static_cast<uint32_t>(std::min<size_t>(n, UINT32_MAX));
+    };
+    m_entries.push_back({static_cast<uint32_t>(m_buffer.size()),
+                         saturate(frequency),
+                         saturate(first_position)});
+    m_buffer.append(word.data(), word.size());
+    m_buffer += '\0';
+}
+
 } // namespace vca
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <set>
+#include <string_view>
 #include <vector>
 
 #include "filesystem.h"
@@ -10,33 +15,156 @@
 namespace vca
 {
 
-struct FileContents
+// The distinct words of a file along with their frequencies and first
+// positions. The words are stored back to back in a single buffer, each
+// followed by a NUL so it can be bound to a statement without a copy. The
+// words of the file name come before those of its text
+class FileContents
 {
-    std::vector<std::string> words;
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        const_iterator(const FileContents& contents, const size_t index)
+            : m_contents{&contents}
+            , m_index{index}
+        {
+        }
+
+        std::string_view
+        operator*() const
+        {
+            return (*m_contents)[m_index];
+        }
+
+        const_iterator&
+        operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+
+        bool
+        operator==(const const_iterator& o) const
+        {
+            return m_index == o.m_index;
+        }
+
+        bool
+        operator!=(const const_iterator& o) const
+        {
+            return m_index != o.m_index;
+        }
+
+    private:
+        const FileContents* m_contents;
+        size_t m_index;
+    };
 
     static FileContents
     fromSearch(std::list<String> values);
 
+    void
+    add(std::string_view word,
+        size_t frequency = 1,
+        size_t first_position = 0);
+
+    // Marks the words added so far as those of the file name. The words of
+    // the text are expected in sorted order so that files with the same text
+    // can share them in the index
+    void
+    end_name()
+    {
+        m_name_size = m_entries.size();
+    }
+
+    // The number of words of the file name
+    size_t
+    name_size() const
+    {
+        return m_name_size;
+    }
+
+    size_t
+    size() const
+    {
+        return m_entries.size();
+    }
+
+    bool
+    empty() const
+    {
+        return m_entries.empty();
+    }
+
+    // The memory allocated for the words
+    size_t
+    byte_count() const
+    {
+        return m_buffer.capacity() + m_entries.capacity() * sizeof(Entry);
+    }
+
+    std::string_view
+    operator[](const size_t i) const
+    {
+        const size_t start = m_entries[i].offset;
+        const size_t end = i + 1 < m_entries.size() ? m_entries[i + 1].offset
+                                                    : m_buffer.size();
+        return std::string_view{m_buffer}.substr(start, end - 1 - start);
+    }
+
+    size_t
+    frequency(const size_t i) const
+    {
+        return m_entries[i].frequency;
+    }
+
+    size_t
+    first_position(const size_t i) const
+    {
+        return m_entries[i].first_position;
+    }
+
+    const_iterator
+    begin() const
+    {
+        return {*this, 0};
+    }
+
+    const_iterator
+    end() const
+    {
+        return {*this, size()};
+    }
+
     bool
     operator<(const FileContents& o) const
     {
-        if (words.size() < o.words.size())
-        {
-            return true;
-        }
-        if (words.size() > o.words.size())
+        if (size() != o.size())
         {
-            return false;
+            return size() < o.size();
         }
-        for (size_t i = 0; i < words.size(); ++i)
-        {
-            if (words[i] < o.words[i])
-            {
-                return true;
-            }
-        }
-        return false;
+        return std::lexicographical_compare(begin(), end(), o.begin(), o.end());
     }
+
+private:
+    struct Entry
+    {
+        // the start of the word in the buffer
+        uint32_t offset;
+        uint32_t frequency;
+        uint32_t first_position;
+    };
+
+    std::string m_buffer;
+    std::vector<Entry> m_entries;
+    size_t m_name_size = 0;
 };
 
 struct SearchResult
@@ -52,6 +180,38 @@ struct SearchResult
     }
 };
 
+struct IndexedFile
+{
+    // relative to the root dir
+    std::string path;
+    Fingerprint fingerprint;
+};
+
+// The changes found by a scan of a root dir
+struct ScanBatch
+{
+    // with fingerprints computed
+    std::vector<std::pair<Path, FileContents>> updated_files;
+    std::vector<Path> removed_files;
+    // the last dir the scan completed, empty once the scan is complete
+    std::string checkpoint;
+    // the patterns of the exclusions pruned, a checkpoint is only resumed
+    // with the same ones
+    std::vector<std::string> exclusions;
+};
+
+// The changes found by a poll of a root dir
+struct PollBatch
+{
+    // with fingerprints computed
+    std::vector<std::pair<Path, FileContents>> updated_files;
+    std::vector<Path> removed_files;
+    // relative dir paths, with a trailing separator, and their mtimes
+    std::vector<std::pair<std::string, uint64_t>> updated_dirs;
+    // relative dir paths whose whole subtrees are gone
+    std::vector<std::string> removed_dirs;
+};
+
 class UserDb
 {
 public:
@@ -84,6 +244,36 @@ public:
     virtual void
     move_file(const Path& old_path, const Path& path) = 0;
 
+    // Returns up to max_count files of root_dir ordered by path whose paths
+    // sort at or after the given one. Used to page through the index in one
+    // pass.
+    virtual std::vector<IndexedFile>
+    list_files(const Path& root_dir,
+               const std::string& from,
+               size_t max_count) const = 0;
+
+    // Returns the checkpoint of an interrupted scan of root_dir with the given
+    // exclusions, or an empty one if there is none
+    virtual std::string
+    scan_checkpoint(const Path& root_dir,
+                    const std::vector<std::string>& exclusions) const = 0;
+
+    // Applies a scan batch and stores its checkpoint in one transaction
+    virtual void
+    commit_scan(const Path& root_dir, const ScanBatch& batch) = 0;
+
+    // Returns the files directly in the given dir of root_dir ordered by path
+    virtual std::vector<IndexedFile>
+    list_dir_files(const Path& root_dir, const std::string& dir) const = 0;
+
+    // Returns the snapshot of dir mtimes of root_dir kept for polling
+    virtual std::map<std::string, uint64_t>
+    list_dirs(const Path& root_dir) const = 0;
+
+    // Applies a poll batch along with its dir mtimes in one transaction
+    virtual void
+    commit_poll(const Path& root_dir, const PollBatch& batch) = 0;
+
     virtual std::vector<SearchResult>
     search(const FileContents& contents) const = 0;
 
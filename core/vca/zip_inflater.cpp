@@ -1,6 +1,8 @@
 #include "zip_inflater.h"
 
-#include <regex>
+#include <algorithm>
+#include <exception>
+#include <memory>
 #include <zip/zip.h>
 
 #include "logging.h"
@@ -11,10 +13,16 @@ namespace vca
 namespace
 {
 
-struct Buffer
+constexpr std::string_view g_regex_chars = ".[]{}()*+?^$|\\";
+
+struct Output
 {
-    std::string data;
+    const std::function<bool(std::string_view)>& write;
     size_t max_byte_count;
+    size_t byte_count = 0;
+    bool stopped = false;
+    // thrown by write, must not unwind through the C library
+    std::exception_ptr error;
 };
 
 size_t
@@ -23,10 +31,21 @@ on_extract(void* const arg,
            const void* const data_void,
            const size_t size)
 {
-    const auto buffer = static_cast<Buffer*>(arg);
+    const auto output = static_cast<Output*>(arg);
     const auto data = static_cast<const char*>(data_void);
-    buffer->data.insert(buffer->data.begin(), data, data + size);
-    if (buffer->data.size() >= buffer->max_byte_count)
+    const auto count =
+        std::min(size, output->max_byte_count - output->byte_count);
+    try
+    {
+        output->stopped = !output->write({data, count});
+    }
+    catch (...)
+    {
+        output->error = std::current_exception();
+        return 0;
+    }
+    output->byte_count += count;
+    if (output->byte_count >= output->max_byte_count || output->stopped)
     {
         return 0;
     }
@@ -48,81 +67,110 @@ struct ZipDeleter
 class ZipFile
 {
 public:
-    ZipFile(const Path& file, const std::string& entry)
+    explicit ZipFile(const Path& file)
         : m_file{zip_open(file.to_narrow().c_str(), 0, 'r'), ZipDeleter{}}
-        , m_regex{entry}
     {
         VCA_CHECK(m_file) << "Could not open zip file: " << file;
-        m_entry_count = static_cast<int>(zip_entries_total(m_file.get()));
     }
 
-    bool
-    process_next_entry(Buffer& buffer)
+    VCA_DELETE_COPY(ZipFile)
+    VCA_DELETE_MOVE(ZipFile)
+
+    void
+    extract(const ZipEntryMatcher& matcher, Output& output)
     {
-        if (m_current_entry >= m_entry_count)
+        if (const auto& name = matcher.name())
         {
-            return false;
+            // a single entry found through the central directory
+            if (zip_entry_open(m_file.get(), name->c_str()) == 0)
+            {
+                extract_entry(output);
+            }
+            return;
         }
-        VCA_CHECK(!zip_entry_openbyindex(m_file.get(), m_current_entry))
-            << "Could not open zip entry at: " << m_current_entry;
-        const std::string name = zip_entry_name(m_file.get());
-        if (std::regex_match(name, m_regex))
+        // opening an entry by index only reads the central directory
+        const auto entry_count =
+            static_cast<int>(zip_entries_total(m_file.get()));
+        for (int i = 0; i < entry_count &&
+             output.byte_count < output.max_byte_count && !output.error &&
+             !output.stopped;
+             ++i)
         {
-            zip_entry_extract(m_file.get(), on_extract, &buffer);
+            VCA_CHECK(!zip_entry_openbyindex(m_file.get(), i))
+                << "Could not open zip entry at: " << i;
+            if (matcher.matches(zip_entry_name(m_file.get())))
+            {
+                extract_entry(output);
+            }
+            else
+            {
+                zip_entry_close(m_file.get());
+            }
         }
-        zip_entry_close(m_file.get());
-        ++m_current_entry;
-        return true;
     }
 
-    VCA_DELETE_COPY(ZipFile)
-    VCA_DELETE_MOVE(ZipFile)
-
 private:
+    void
+    extract_entry(Output& output)
+    {
+        zip_entry_extract(m_file.get(), on_extract, &output);
+        zip_entry_close(m_file.get());
+    }
+
     std::unique_ptr<zip_t, ZipDeleter> m_file;
-    std::regex m_regex;
-    int m_entry_count = 0;
-    int m_current_entry = 0;
 };
 
 } // namespace
 
-struct ZipInflater::Impl
+ZipEntryMatcher::ZipEntryMatcher(const std::string& pattern)
+    : m_regex{pattern}
 {
-    Impl(const Path& file,
-         const size_t max_byte_count,
-         const std::string& entry)
-        : zip_file{file, entry}
+    if (pattern.find_first_of(g_regex_chars.substr(1)) == std::string::npos)
     {
-        buffer.max_byte_count = max_byte_count;
-        while (buffer.data.size() <= max_byte_count &&
-               zip_file.process_next_entry(buffer))
-            ;
+        m_name = pattern;
+        return;
     }
+    auto prefix_size = pattern.find_first_of(g_regex_chars);
+    // a quantifier makes the char before it optional
+    if (prefix_size > 0 &&
+        std::string_view{"*?{"}.find(pattern[prefix_size]) !=
+            std::string_view::npos)
+    {
+        --prefix_size;
+    }
+    m_prefix = pattern.substr(0, prefix_size);
+}
 
-    ZipFile zip_file;
-    Buffer buffer;
-};
-
-ZipInflater::ZipInflater(const Path& file,
-                         const size_t max_byte_count,
-                         const std::string& entry)
-    : m_impl{std::make_unique<Impl>(file, max_byte_count, entry)}
+const std::optional<std::string>&
+ZipEntryMatcher::name() const
 {
+    return m_name;
 }
 
-ZipInflater::~ZipInflater() = default;
-
-const std::string&
-ZipInflater::get() const&
+bool
+ZipEntryMatcher::matches(const std::string& name) const
 {
-    return m_impl->buffer.data;
+    if (m_name)
+    {
+        return name == *m_name;
+    }
+    return name.compare(0, m_prefix.size(), m_prefix) == 0 &&
+        std::regex_match(name, m_regex);
 }
 
-std::string&&
-ZipInflater::get() &&
+size_t
+inflate_zip(const Path& file,
+            const ZipEntryMatcher& matcher,
+            const size_t max_byte_count,
+            const std::function<bool(std::string_view)>& write)
 {
-    return std::move(m_impl->buffer.data);
+    Output output{write, max_byte_count, 0, false, nullptr};
+    ZipFile{file}.extract(matcher, output);
+    if (output.error)
+    {
+        std::rethrow_exception(output.error);
+    }
+    return output.byte_count;
 }
 
 } // namespace vca
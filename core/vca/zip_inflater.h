@@ -1,34 +1,45 @@
 #pragma once
 
-#include <memory>
+#include <functional>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
 
 #include "filesystem.h"
-#include "utils.h"
 
 namespace vca
 {
 
-class ZipInflater
+// Matches the names of zip entries against a regex compiled once. A pattern
+// without regex syntax other than dots is taken as the name of a single entry
+// that is looked up in the central directory
+class ZipEntryMatcher
 {
 public:
-    ZipInflater(const Path& file,
-                size_t max_byte_count,
-                const std::string& entry);
+    explicit ZipEntryMatcher(const std::string& pattern);
 
-    VCA_DELETE_COPY(ZipInflater)
-    VCA_DEFAULT_MOVE(ZipInflater)
+    // The name of the single entry matched, if any
+    const std::optional<std::string>&
+    name() const;
 
-    ~ZipInflater();
-
-    const std::string&
-    get() const&;
-
-    std::string&&
-    get() &&;
+    bool
+    matches(const std::string& name) const;
 
 private:
-    struct Impl;
-    std::unique_ptr<Impl> m_impl;
+    std::optional<std::string> m_name;
+    // a prefix all names matched start with
+    std::string m_prefix;
+    std::regex m_regex;
 };
 
+// Inflates the entries matched in the order of the archive and passes the
+// data to write in chunks, up to a total of max_byte_count bytes or until
+// write returns false. Returns the number of bytes passed
+size_t
+inflate_zip(const Path& file,
+            const ZipEntryMatcher& matcher,
+            size_t max_byte_count,
+            const std::function<bool(std::string_view)>& write);
+
 } // namespace vca
@@ -0,0 +1,103 @@
+#include "content_sniffer.h"
+
+#include <vca/string.h>
+
+namespace vca
+{
+
+namespace
+{
+
+// pdf readers look for the header this far into a file
+constexpr size_t g_max_byte_count = 1024;
+
+struct Magic
+{
+    size_t offset;
+    std::string_view bytes;
+    ContentType type;
+};
+
+using namespace std::string_view_literals;
+
+// sorted roughly by how common these are among the files of a home dir
+constexpr Magic g_magics[] = {
+    {0, "%PDF-"sv, ContentType::Pdf},
+    {0, "PK\x03\x04"sv, ContentType::Zip},
+    {0, "{\\rtf"sv, ContentType::Rtf},
+    {0, "<?xml"sv, ContentType::Xml},
+    {0, "\xff\xd8\xff"sv, ContentType::Binary},         // jpeg
+    {0, "\x89PNG"sv, ContentType::Binary},              // png
+    {0, "GIF8"sv, ContentType::Binary},                 // gif
+    {0, "II*\0"sv, ContentType::Binary},                // tiff
+    {0, "MM\0*"sv, ContentType::Binary},                // tiff
+    {4, "ftyp"sv, ContentType::Binary},                 // mp4, mov, heic
+    {0, "ID3"sv, ContentType::Binary},                  // mp3
+    {0, "RIFF"sv, ContentType::Binary},                 // wav, avi, webp
+    {0, "OggS"sv, ContentType::Binary},                 // ogg
+    {0, "fLaC"sv, ContentType::Binary},                 // flac
+    {0, "\x1a\x45\xdf\xa3"sv, ContentType::Binary},     // mkv, webm
+    {0, "\x1f\x8b"sv, ContentType::Binary},             // gzip
+    {0, "BZh"sv, ContentType::Binary},                  // bzip2
+    {0, "\xfd" "7zXZ"sv, ContentType::Binary},          // xz
+    {0, "7z\xbc\xaf"sv, ContentType::Binary},           // 7z
+    {0, "Rar!"sv, ContentType::Binary},                 // rar
+    {0, "\x7f" "ELF"sv, ContentType::Binary},           // elf
+    {0, "MZ"sv, ContentType::Binary},                   // exe, dll
+    {0, "\xca\xfe\xba\xbe"sv, ContentType::Binary},     // mach-o, class
+    {0, "\xcf\xfa\xed\xfe"sv, ContentType::Binary},     // mach-o
+    {0, "SQLite format 3\0"sv, ContentType::Binary},    // sqlite
+    {0, "\xd0\xcf\x11\xe0"sv, ContentType::Binary},     // doc, xls, msi
+};
+
+bool
+starts_with(const std::string_view str, const std::string_view prefix)
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+ContentType
+sniff_content(std::string_view head, const String& ext)
+{
+    for (const auto& magic : g_magics)
+    {
+        if (head.size() >= magic.offset &&
+            starts_with(head.substr(magic.offset), magic.bytes))
+        {
+            return magic.type;
+        }
+    }
+    // pdf allows for junk before the header, but text quoting a header is far
+    // more common, so it is only looked for in files named pdf
+    if (ext == U".pdf" && head.find("%PDF-"sv) != std::string_view::npos)
+    {
+        return ContentType::Pdf;
+    }
+    constexpr auto bom = "\xef\xbb\xbf"sv;
+    if (starts_with(head, bom))
+    {
+        head.remove_prefix(bom.size());
+        if (starts_with(head, "<?xml"sv))
+        {
+            return ContentType::Xml;
+        }
+    }
+    // text hardly ever contains nulls while nearly all binary formats do
+    if (head.find('\0') != std::string_view::npos ||
+        !is_valid_utf8(head, true))
+    {
+        return ContentType::Binary;
+    }
+    return ContentType::Text;
+}
+
+ContentType
+sniff_content(const Path& file, const String& ext)
+{
+    FileReader reader{file};
+    return sniff_content(reader.read(g_max_byte_count), ext);
+}
+
+} // namespace vca
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string_view>
+
+#include <vca/filesystem.h>
+#include <vca/string.h>
+
+namespace vca
+{
+
+enum class ContentType
+{
+    Binary,
+    Text,
+    Xml,
+    Pdf,
+    Rtf,
+    Zip,
+};
+
+// Guesses the type of content from its first bytes by looking for well-known
+// magic bytes and, failing that, by checking for text in UTF-8. The lower-case
+// extension of the file only matters for magic bytes that may come after junk
+ContentType
+sniff_content(std::string_view head, const String& ext);
+
+// Sniffs the first kilobyte of a file
+ContentType
+sniff_content(const Path& file, const String& ext);
+
+} // namespace vca
@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <atomic>
 #include <csignal>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <set>
 #include <thread>
 #include <vector>
@@ -15,6 +18,8 @@
 #include <vca/time.h>
 #include <vca/utils.h>
 
+#include "extractor_pool.h"
+#include "file_poller.h"
 #include "file_processor.h"
 #include "file_scanner.h"
 #include "file_watcher.h"
@@ -27,19 +32,94 @@
 
 std::atomic<int> g_signal_status{0};
 
+// The tokenizers relying on third-party parsers run in worker processes
+const std::set<std::string> g_sandboxed_tokenizers{"pdf", "zipxml"};
+
+constexpr size_t g_extractor_count = 4;
+
+// the resident memory an extractor may use before it is killed
+constexpr size_t g_max_extractor_memory_byte_count = 1024 * 1024 * 1024;
+
 void
 signal_handler(const int signal)
 {
     g_signal_status = signal;
 }
 
+// The tokenizers by extension, the same in the daemon and its extractors
+std::map<vca::String, std::unique_ptr<vca::Tokenizer>>
+make_tokenizers(const size_t pdf_thread_count)
+{
+    std::map<vca::String, std::unique_ptr<vca::Tokenizer>> tokenizers;
+    tokenizers.emplace(
+        U".docx", std::make_unique<vca::ZipxmlTokenizer>("word/document.xml"));
+    tokenizers.emplace(
+        U".xlsx",
+        std::make_unique<vca::ZipxmlTokenizer>("xl/sharedStrings.xml"));
+    tokenizers.emplace(U".pptx",
+                       std::make_unique<vca::ZipxmlTokenizer>(
+                           "ppt/slides/slide[0-9]\\d*.xml"));
+    tokenizers.emplace(U".odt",
+                       std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
+    tokenizers.emplace(U".ods",
+                       std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
+    tokenizers.emplace(U".odp",
+                       std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
+    tokenizers.emplace(U".htm", std::make_unique<vca::XmlTokenizer>(true));
+    tokenizers.emplace(U".html", std::make_unique<vca::XmlTokenizer>(true));
+    tokenizers.emplace(U".pdf",
+                       std::make_unique<vca::PdfTokenizer>(pdf_thread_count));
+    tokenizers.emplace(U".rtf", std::make_unique<vca::TexTokenizer>());
+    tokenizers.emplace(U".svg", std::make_unique<vca::XmlTokenizer>());
+    tokenizers.emplace(U".tex", std::make_unique<vca::TexTokenizer>());
+    tokenizers.emplace(U".xml", std::make_unique<vca::TxtTokenizer>(true));
+    return tokenizers;
+}
+
+int
+extractor_main(const int argc, char** argv)
+{
+    try
+    {
+        vca::init_logging();
+        vca::set_log_level(vca::Logger::Level::Warn);
+        std::map<std::string, std::unique_ptr<vca::Tokenizer>> tokenizers;
+        // the extractors share the cores
+        const auto pdf_thread_count = std::max<size_t>(
+            std::thread::hardware_concurrency() / g_extractor_count, 1);
+        for (auto& [ext, tokenizer] : make_tokenizers(pdf_thread_count))
+        {
+            if (g_sandboxed_tokenizers.count(tokenizer->name()) > 0)
+            {
+                tokenizers.emplace(vca::wide_to_narrow(ext),
+                                   std::move(tokenizer));
+            }
+        }
+        return vca::run_extractor(argc, argv, tokenizers);
+    }
+    catch (const std::exception& e)
+    {
+        VCA_EXCEPTION(e) << e.what();
+        return EXIT_FAILURE;
+    }
+}
+
 int
-main(const int, char**)
+main(const int argc, char** argv)
 {
+    if (vca::is_extractor(argc, argv))
+    {
+        return extractor_main(argc, argv);
+    }
+
     try
     {
         std::signal(SIGINT, signal_handler);
         std::signal(SIGTERM, signal_handler);
+#ifdef VCA_PLATFORM_UNIX
+        // a crashed extractor must not take the daemon with it
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
 
         const auto work_dir = vca::user_config_dir() / vca::Path{"findle"};
         vca::create_directories(work_dir);
@@ -62,38 +142,28 @@ main(const int, char**)
                                   vca::UserDb::OpenType::ReadWrite};
         user_db.create(user_config.root_dirs());
 
-        vca::FileProcessor file_processor{app_config};
+        vca::ExtractorPool extractors{g_extractor_count,
+                                      g_max_extractor_memory_byte_count};
+
+        vca::FileProcessor file_processor{app_config, user_config};
         file_processor.set_default_tokenizer(
             std::make_unique<vca::TxtTokenizer>());
-        file_processor.add_tokenizer(
-            U".docx",
-            std::make_unique<vca::ZipxmlTokenizer>("word/document.xml"));
-        file_processor.add_tokenizer(
-            U".xlsx",
-            std::make_unique<vca::ZipxmlTokenizer>("xl/sharedStrings.xml"));
-        file_processor.add_tokenizer(U".pptx",
-                                     std::make_unique<vca::ZipxmlTokenizer>(
-                                         "ppt/slides/slide[0-9]\\d*.xml"));
-        file_processor.add_tokenizer(
-            U".odt", std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
-        file_processor.add_tokenizer(
-            U".ods", std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
-        file_processor.add_tokenizer(
-            U".odp", std::make_unique<vca::ZipxmlTokenizer>("content.xml"));
-        file_processor.add_tokenizer(U".pdf",
-                                     std::make_unique<vca::PdfTokenizer>());
-        file_processor.add_tokenizer(U".rtf",
-                                     std::make_unique<vca::TexTokenizer>());
-        file_processor.add_tokenizer(U".svg",
-                                     std::make_unique<vca::XmlTokenizer>());
-        file_processor.add_tokenizer(U".tex",
-                                     std::make_unique<vca::TexTokenizer>());
-        file_processor.add_tokenizer(U".xml",
-                                     std::make_unique<vca::TxtTokenizer>(true));
+        for (auto& [ext, tokenizer] : make_tokenizers(0))
+        {
+            if (g_sandboxed_tokenizers.count(tokenizer->name()) > 0)
+            {
+                tokenizer = std::make_unique<vca::SandboxedTokenizer>(
+                    extractors, vca::wide_to_narrow(ext), tokenizer->name());
+            }
+            file_processor.add_tokenizer(ext, std::move(tokenizer));
+        }
 
         vca::FileWatcher file_watcher{
             commands, user_config, user_db, file_processor};
 
+        vca::FilePoller file_poller{
+            commands, user_config, user_db, file_processor};
+
         vca::FileScanner file_scanner{
             commands, user_config, user_db, file_processor};
 
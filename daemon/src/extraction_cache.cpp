@@ -0,0 +1,228 @@
+#include "extraction_cache.h"
+
+#include <fstream>
+
+#include <cryptopp/blake2.h>
+
+namespace vca
+{
+
+namespace
+{
+
+// Larger files are rarely copied around and take long to hash
+constexpr size_t g_max_hashed_byte_count = 64 * 1024 * 1024;
+
+constexpr size_t g_chunk_size = 65536;
+
+// roughly what an entry takes besides its terms, e.g. for the path
+constexpr size_t g_entry_byte_count = 256;
+
+bool
+is_unchanged(const Path& file, uint64_t size, uint64_t last_write_time)
+{
+    try
+    {
+        return file.size() == size &&
+               file.last_write_time() == last_write_time;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
+} // namespace
+
+ExtractionCache::ExtractionCache(const size_t max_byte_count)
+    : m_max_byte_count{max_byte_count}
+{
+}
+
+ExtractionCache::Key
+ExtractionCache::key(const Path& file, const Tokenizer& tokenizer)
+{
+    Key key;
+    key.file = file;
+    key.tokenizer = &tokenizer;
+    try
+    {
+        key.size = file.size();
+        key.last_write_time = file.last_write_time();
+    }
+    catch (const std::exception&)
+    {
+        return key;
+    }
+    if (key.size > g_max_hashed_byte_count)
+    {
+        return key;
+    }
+    key.cacheable = true;
+
+    std::optional<FirstFile> first_file;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        const auto entry = m_first_files.find({key.size, &tokenizer});
+        if (entry == m_first_files.end() || entry->second.file == file)
+        {
+            return key;
+        }
+        if (entry->second.terms)
+        {
+            // the entry stays to mark the size as seen
+            m_byte_count -= entry->second.byte_count - g_entry_byte_count;
+            entry->second.byte_count = g_entry_byte_count;
+            first_file = std::move(entry->second);
+            entry->second.terms.reset();
+        }
+    }
+
+    key.digest = digest(file);
+    // the terms of the first file are only valid for it if it is unchanged
+    if (first_file && is_unchanged(first_file->file,
+                                   key.size,
+                                   first_file->last_write_time))
+    {
+        if (const auto first_digest = digest(first_file->file))
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            insert_digest({*first_digest, &tokenizer},
+                          std::move(*first_file->terms));
+            evict();
+        }
+    }
+    return key;
+}
+
+std::optional<FileContents>
+ExtractionCache::find(const Key& key)
+{
+    if (!key.digest)
+    {
+        return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+    const auto entry = m_index.find({*key.digest, key.tokenizer});
+    if (entry == m_index.end())
+    {
+        return std::nullopt;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, entry->second);
+    entry->second->tick = ++m_tick;
+    return entry->second->terms;
+}
+
+void
+ExtractionCache::insert(const Key& key, FileContents terms)
+{
+    if (!key.cacheable)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (key.digest)
+    {
+        insert_digest({*key.digest, key.tokenizer}, std::move(terms));
+        evict();
+        return;
+    }
+    const auto byte_count = terms.byte_count() + g_entry_byte_count;
+    if (byte_count > m_max_byte_count)
+    {
+        return;
+    }
+    const SizeKey size_key{key.size, key.tokenizer};
+    auto& [first_key, first_file] = *m_first_files.try_emplace(size_key).first;
+    if (first_file.tick == 0)
+    {
+        first_file.position =
+            m_first_file_queue.insert(m_first_file_queue.end(), first_key);
+    }
+    else
+    {
+        m_byte_count -= first_file.byte_count;
+        m_first_file_queue.splice(
+            m_first_file_queue.end(), m_first_file_queue, first_file.position);
+    }
+    first_file.file = key.file;
+    first_file.last_write_time = key.last_write_time;
+    first_file.terms = std::move(terms);
+    first_file.byte_count = byte_count;
+    first_file.tick = ++m_tick;
+    m_byte_count += byte_count;
+    evict();
+}
+
+void
+ExtractionCache::clear()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_index.clear();
+    m_entries.clear();
+    m_first_files.clear();
+    m_first_file_queue.clear();
+    m_byte_count = 0;
+}
+
+std::optional<ExtractionCache::Digest>
+ExtractionCache::digest(const Path& file)
+{
+    auto f = make_ifstream(file, std::ios_base::binary);
+    if (!f)
+    {
+        return std::nullopt;
+    }
+    Digest digest;
+    CryptoPP::BLAKE2b hash{false, static_cast<unsigned int>(digest.size())};
+    std::string chunk(g_chunk_size, 0);
+    while (f)
+    {
+        f.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        hash.Update(reinterpret_cast<const unsigned char*>(chunk.data()),
+                    static_cast<size_t>(f.gcount()));
+    }
+    hash.Final(digest.data());
+    return digest;
+}
+
+void
+ExtractionCache::insert_digest(const DigestKey& key, FileContents terms)
+{
+    const auto byte_count = terms.byte_count() + g_entry_byte_count;
+    if (m_index.count(key) > 0 || byte_count > m_max_byte_count)
+    {
+        return;
+    }
+    m_entries.push_front({key, std::move(terms), byte_count, ++m_tick});
+    m_index.emplace(key, m_entries.begin());
+    m_byte_count += byte_count;
+}
+
+void
+ExtractionCache::evict()
+{
+    while (m_byte_count > m_max_byte_count)
+    {
+        // the first files are in the order of their ticks, too
+        const auto first_file = m_first_file_queue.empty()
+            ? m_first_files.end()
+            : m_first_files.find(m_first_file_queue.front());
+        if (first_file != m_first_files.end() &&
+            (m_entries.empty() ||
+             first_file->second.tick < m_entries.back().tick))
+        {
+            m_byte_count -= first_file->second.byte_count;
+            m_first_files.erase(first_file);
+            m_first_file_queue.pop_front();
+        }
+        else
+        {
+            m_byte_count -= m_entries.back().byte_count;
+            m_index.erase(m_entries.back().key);
+            m_entries.pop_back();
+        }
+    }
+}
+
+} // namespace vca
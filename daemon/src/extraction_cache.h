@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+
+#include <vca/userdb.h>
+
+#include "tokenizer.h"
+
+namespace vca
+{
+
+// The terms extracted from recently processed files by the digest of their
+// contents and the tokenizer used, so that byte-identical copies of a file are
+// only tokenized once. Hashing a whole file costs more I/O than a budgeted
+// extraction reads, so a file is only hashed once another file of the same
+// size was processed with the same tokenizer. The first file of a size keeps
+// its terms by path and is hashed when a second one shows up. Copies are thus
+// found from the second one on while files of unique sizes are never hashed.
+// The terms of the least recently used files are dropped once all terms kept
+// take more than a given number of bytes. Called from multiple threads
+class ExtractionCache
+{
+public:
+    using Digest = std::array<unsigned char, 16>;
+
+    // Identifies a file to be looked up and then inserted
+    class Key
+    {
+    private:
+        friend class ExtractionCache;
+
+        Path file;
+        const Tokenizer* tokenizer = nullptr;
+        uint64_t size = 0;
+        uint64_t last_write_time = 0;
+        bool cacheable = false;
+        std::optional<Digest> digest;
+    };
+
+    explicit ExtractionCache(size_t max_byte_count);
+
+    VCA_DELETE_COPY(ExtractionCache)
+    VCA_DELETE_MOVE(ExtractionCache)
+
+    // Hashes the file if another file of its size was processed with the
+    // tokenizer
+    Key
+    key(const Path& file, const Tokenizer& tokenizer);
+
+    std::optional<FileContents>
+    find(const Key& key);
+
+    void
+    insert(const Key& key, FileContents terms);
+
+    // Drops all entries, e.g. once the extraction limits changed
+    void
+    clear();
+
+private:
+    using DigestKey = std::pair<Digest, const Tokenizer*>;
+    using SizeKey = std::pair<uint64_t, const Tokenizer*>;
+
+    struct DigestEntry
+    {
+        DigestKey key;
+        FileContents terms;
+        size_t byte_count;
+        // when the entry was last used
+        uint64_t tick;
+    };
+
+    // The first file of a size processed, its terms are moved to the digest
+    // entries once another file of that size shows up
+    struct FirstFile
+    {
+        Path file;
+        uint64_t last_write_time = 0;
+        std::optional<FileContents> terms;
+        size_t byte_count = 0;
+        // when the file was inserted
+        uint64_t tick = 0;
+        std::list<SizeKey>::iterator position;
+    };
+
+    static std::optional<Digest>
+    digest(const Path& file);
+
+    void
+    insert_digest(const DigestKey& key, FileContents terms);
+
+    // Drops the least recently used first files and digest entries until
+    // the bytes kept are within the bound
+    void
+    evict();
+
+    size_t m_max_byte_count;
+    size_t m_byte_count = 0;
+    uint64_t m_tick = 0;
+    std::mutex m_mutex;
+    // the most recently used first
+    std::list<DigestEntry> m_entries;
+    std::map<DigestKey, std::list<DigestEntry>::iterator> m_index;
+    std::map<SizeKey, FirstFile> m_first_files;
+    // the order in which the first files were inserted
+    std::list<SizeKey> m_first_file_queue;
+};
+
+} // namespace vca
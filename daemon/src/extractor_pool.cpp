@@ -0,0 +1,495 @@
+#include "extractor_pool.h"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include <boost/dll/runtime_symbol_info.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/process.hpp>
+
+#ifdef VCA_PLATFORM_LINUX
+#include <unistd.h>
+#endif
+
+#include <vca/logging.h>
+
+namespace bip = boost::interprocess;
+namespace bp = boost::process;
+
+namespace vca
+{
+
+namespace
+{
+
+constexpr const char* g_extractor_arg = "--extractor";
+
+constexpr size_t g_ring_capacity = 1024 * 1024;
+
+// How long a worker may run past the time limit of a job before it is killed
+constexpr size_t g_kill_delay_ms = 2000;
+
+// How long a worker may run after its job was cancelled before it is killed
+constexpr size_t g_cancel_delay_ms = 50;
+
+// The time limit of jobs whose tokenizer has none
+constexpr size_t g_default_max_time_ms = 60000;
+
+constexpr auto g_min_poll_interval = std::chrono::microseconds{10};
+constexpr auto g_max_poll_interval = std::chrono::microseconds{1000};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+// The start of the shared memory of a worker, followed by the ring buffer
+struct SharedState
+{
+    // the positions of the ring buffer, which only grow
+    std::atomic<uint64_t> read_position{0};
+    std::atomic<uint64_t> write_position{0};
+    // the last job finished and whether it failed
+    std::atomic<uint64_t> finished_job{0};
+    std::atomic<bool> failed{false};
+    // whether the current job is cancelled
+    std::atomic<bool> cancelled{false};
+};
+
+constexpr size_t g_shared_memory_size = sizeof(SharedState) + g_ring_capacity;
+
+// the size of a token is written before it
+constexpr size_t g_max_token_size = g_ring_capacity - sizeof(uint32_t);
+
+// A ring buffer of tokens each prefixed by its size with the worker as the
+// only writer and the pool as the only reader
+class TokenRing
+{
+public:
+    explicit TokenRing(bip::mapped_region& region)
+        : m_state{*static_cast<SharedState*>(region.get_address())}
+        , m_data{static_cast<char*>(region.get_address()) +
+                 sizeof(SharedState)}
+    {
+    }
+
+    SharedState&
+    state()
+    {
+        return m_state;
+    }
+
+    // Waits for the pool to make room as long as the ring is full. Tokens
+    // larger than the ring are cut off at the last character fitting
+    void
+    push(std::string_view token)
+    {
+        if (token.size() > g_max_token_size)
+        {
+            auto size = g_max_token_size;
+            while (size > 0 &&
+                   (static_cast<unsigned char>(token[size]) & 0xc0) == 0x80)
+            {
+                --size;
+            }
+            VCA_WARN << "Truncating token of " << token.size()
+                     << " bytes to " << size;
+            token = token.substr(0, size);
+        }
+        const auto size = static_cast<uint32_t>(token.size());
+        const auto record_size = sizeof(size) + token.size();
+        const auto write_position =
+            m_state.write_position.load(std::memory_order_relaxed);
+        while (write_position + record_size -
+                   m_state.read_position.load(std::memory_order_acquire) >
+               g_ring_capacity)
+        {
+            std::this_thread::sleep_for(g_min_poll_interval);
+        }
+        copy_in(write_position, &size, sizeof(size));
+        copy_in(write_position + sizeof(size), token.data(), token.size());
+        m_state.write_position.store(write_position + record_size,
+                                     std::memory_order_release);
+    }
+
+    // Pushes the tokens written so far to the sink
+    void
+    drain(TokenSink& sink)
+    {
+        auto read_position =
+            m_state.read_position.load(std::memory_order_relaxed);
+        const auto write_position =
+            m_state.write_position.load(std::memory_order_acquire);
+        while (read_position < write_position)
+        {
+            uint32_t size = 0;
+            copy_out(read_position, &size, sizeof(size));
+            m_token.resize(size);
+            copy_out(read_position + sizeof(size), m_token.data(), size);
+            read_position += sizeof(size) + size;
+            m_state.read_position.store(read_position,
+                                        std::memory_order_release);
+            sink.push(m_token);
+        }
+    }
+
+private:
+    void
+    copy_in(const uint64_t position, const void* data, const size_t size)
+    {
+        const auto index = static_cast<size_t>(position % g_ring_capacity);
+        const auto count = std::min(size, g_ring_capacity - index);
+        std::memcpy(m_data + index, data, count);
+        std::memcpy(
+            m_data, static_cast<const char*>(data) + count, size - count);
+    }
+
+    void
+    copy_out(const uint64_t position, void* data, const size_t size) const
+    {
+        const auto index = static_cast<size_t>(position % g_ring_capacity);
+        const auto count = std::min(size, g_ring_capacity - index);
+        std::memcpy(data, m_data + index, count);
+        std::memcpy(static_cast<char*>(data) + count, m_data, size - count);
+    }
+
+    SharedState& m_state;
+    char* m_data;
+    std::string m_token;
+};
+
+class RingSink : public TokenSink
+{
+public:
+    explicit RingSink(TokenRing& ring)
+        : m_ring{ring}
+    {
+    }
+
+    void
+    push(const std::string_view token) override
+    {
+        m_ring.push(token);
+    }
+
+private:
+    TokenRing& m_ring;
+};
+
+// Returns the resident memory of a process, or 0 where it cannot be read
+size_t
+resident_byte_count(const bp::pid_t pid)
+{
+#ifdef VCA_PLATFORM_LINUX
+    std::ifstream statm{"/proc/" + std::to_string(pid) + "/statm"};
+    size_t page_count = 0;
+    size_t resident_page_count = 0;
+    if (!(statm >> page_count >> resident_page_count))
+    {
+        return 0;
+    }
+    return resident_page_count * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    static_cast<void>(pid);
+    return 0;
+#endif
+}
+
+bip::mapped_region
+create_shared_memory(const std::string& name)
+{
+    bip::shared_memory_object::remove(name.c_str());
+    bip::shared_memory_object memory{
+        bip::create_only, name.c_str(), bip::read_write};
+    memory.truncate(static_cast<bip::offset_t>(g_shared_memory_size));
+    bip::mapped_region region{memory, bip::read_write};
+    new (region.get_address()) SharedState;
+    return region;
+}
+
+} // namespace
+
+class ExtractorPool::Worker
+{
+public:
+    Worker(std::string name, const size_t max_memory_byte_count)
+        : m_name{std::move(name)}
+        , m_max_memory_byte_count{max_memory_byte_count}
+        , m_region{create_shared_memory(m_name)}
+        , m_ring{m_region}
+    {
+    }
+
+    VCA_DELETE_COPY(Worker)
+    VCA_DELETE_MOVE(Worker)
+
+    ~Worker()
+    {
+        stop();
+        bip::shared_memory_object::remove(m_name.c_str());
+    }
+
+    void
+    extract(const std::string& tokenizer,
+            const Path& file,
+            TokenSink& sink,
+            const ExtractionBudget& budget)
+    {
+        const auto& limits = budget.limits();
+        auto& state = m_ring.state();
+        state.cancelled = false;
+        const auto job = ++m_job;
+        if (!send(job, tokenizer, file, limits))
+        {
+            // the worker may have died since its last job
+            stop();
+            VCA_CHECK(send(job, tokenizer, file, limits))
+                << "Cannot start extractor for: " << file;
+        }
+
+        const auto max_time_ms =
+            (limits.max_time_ms > 0 ? limits.max_time_ms
+                                    : g_default_max_time_ms) +
+            g_kill_delay_ms;
+        auto poll_interval = g_min_poll_interval;
+        Timer timer;
+        std::optional<Timer> cancel_timer;
+        for (;;)
+        {
+            m_ring.drain(sink);
+            if (state.finished_job.load(std::memory_order_acquire) == job)
+            {
+                m_ring.drain(sink);
+                VCA_CHECK(!state.failed.load())
+                    << "Extraction failed for: " << file;
+                return;
+            }
+            if (!m_process->running())
+            {
+                m_ring.drain(sink);
+                VCA_WARN << "Extractor crashed on: " << file;
+                stop();
+                return;
+            }
+            if (budget.cancelled() && !cancel_timer)
+            {
+                state.cancelled = true;
+                cancel_timer.emplace();
+            }
+            if (cancel_timer && cancel_timer->us() > g_cancel_delay_ms * 1000)
+            {
+                stop();
+                m_ring.drain(sink);
+                return;
+            }
+            if (timer.us() > max_time_ms * 1000)
+            {
+                stop();
+                m_ring.drain(sink);
+                VCA_WARN << "Extractor killed after " << max_time_ms
+                         << " ms on: " << file;
+                return;
+            }
+            if (m_max_memory_byte_count > 0 &&
+                resident_byte_count(m_process->id()) > m_max_memory_byte_count)
+            {
+                stop();
+                m_ring.drain(sink);
+                VCA_WARN << "Extractor killed using more than "
+                         << m_max_memory_byte_count << " bytes on: " << file;
+                return;
+            }
+            std::this_thread::sleep_for(poll_interval);
+            poll_interval = std::min(poll_interval * 2, g_max_poll_interval);
+        }
+    }
+
+private:
+    // Starts the process if needed. Returns false if the job cannot be sent
+    bool
+    send(const uint64_t job,
+         const std::string& tokenizer,
+         const Path& file,
+         const ExtractionLimits& limits)
+    {
+        if (!m_process)
+        {
+            m_jobs = bp::opstream{};
+            m_process = std::make_unique<bp::child>(
+                bp::exe = boost::dll::program_location(),
+                bp::args = std::vector<std::string>{g_extractor_arg, m_name},
+                bp::std_in < m_jobs);
+        }
+        const auto path = file.to_narrow();
+        m_jobs << job << '\n'
+               << tokenizer << '\n'
+               << limits.max_byte_count << '\n'
+               << limits.max_time_ms << '\n'
+               << path.size() << '\n'
+               << path << std::flush;
+        return static_cast<bool>(m_jobs);
+    }
+
+    void
+    stop()
+    {
+        if (m_process)
+        {
+            std::error_code error;
+            if (m_process->running(error))
+            {
+                m_process->terminate(error);
+            }
+            m_process.reset();
+        }
+        m_jobs = bp::opstream{};
+    }
+
+    std::string m_name;
+    size_t m_max_memory_byte_count;
+    bip::mapped_region m_region;
+    TokenRing m_ring;
+    bp::opstream m_jobs;
+    std::unique_ptr<bp::child> m_process;
+    uint64_t m_job = 0;
+};
+
+ExtractorPool::ExtractorPool(const size_t worker_count,
+                             const size_t max_memory_byte_count)
+    : m_max_memory_byte_count{max_memory_byte_count}
+{
+    const auto prefix =
+        "findle_extractor_" + std::to_string(boost::this_process::get_id());
+    for (size_t i = 0; i < std::max<size_t>(worker_count, 1); ++i)
+    {
+        m_workers.push_back(std::make_unique<Worker>(
+            prefix + "_" + std::to_string(i), m_max_memory_byte_count));
+        m_idle_workers.push_back(m_workers.back().get());
+    }
+}
+
+ExtractorPool::~ExtractorPool() = default;
+
+void
+ExtractorPool::extract(const std::string& tokenizer,
+                       const Path& file,
+                       TokenSink& sink,
+                       const ExtractionBudget& budget)
+{
+    Worker* worker = nullptr;
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while (!m_cond_var.wait_for(lock, g_max_poll_interval, [this] {
+            return !m_idle_workers.empty();
+        }))
+        {
+            if (budget.cancelled())
+            {
+                return;
+            }
+        }
+        worker = m_idle_workers.back();
+        m_idle_workers.pop_back();
+    }
+    const auto release = [this, worker] {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_idle_workers.push_back(worker);
+        }
+        m_cond_var.notify_one();
+    };
+    try
+    {
+        worker->extract(tokenizer, file, sink, budget);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    release();
+}
+
+SandboxedTokenizer::SandboxedTokenizer(ExtractorPool& pool,
+                                       std::string key,
+                                       std::string name)
+    : m_pool{pool}
+    , m_key{std::move(key)}
+    , m_name{std::move(name)}
+{
+}
+
+std::string
+SandboxedTokenizer::name() const
+{
+    return m_name;
+}
+
+void
+SandboxedTokenizer::extract(const Path& file,
+                            TokenSink& sink,
+                            ExtractionBudget& budget) const
+{
+    m_pool.extract(m_key, file, sink, budget);
+}
+
+bool
+is_extractor(const int argc, char** argv)
+{
+    return argc == 3 && std::strcmp(argv[1], g_extractor_arg) == 0;
+}
+
+int
+run_extractor(const int argc,
+              char** argv,
+              const std::map<std::string, std::unique_ptr<Tokenizer>>&
+                  tokenizers)
+{
+    VCA_CHECK(is_extractor(argc, argv));
+    const std::string name = argv[2];
+
+    bip::shared_memory_object memory{
+        bip::open_only, name.c_str(), bip::read_write};
+    bip::mapped_region region{memory, bip::read_write};
+    TokenRing ring{region};
+    RingSink sink{ring};
+    auto& state = ring.state();
+
+    uint64_t job = 0;
+    std::string key;
+    ExtractionLimits limits;
+    size_t path_size = 0;
+    // the pool closes the pipe when it goes away
+    while (std::cin >> job >> key >> limits.max_byte_count >>
+           limits.max_time_ms >> path_size)
+    {
+        std::cin.ignore(); // the line feed
+        std::string path(path_size, 0);
+        std::cin.read(path.data(), static_cast<std::streamsize>(path_size));
+        bool failed = true;
+        try
+        {
+            const auto tokenizer = tokenizers.find(key);
+            VCA_CHECK(tokenizer != tokenizers.end()) << key;
+            ExtractionBudget budget{limits, &state.cancelled};
+            tokenizer->second->extract(Path{path}, sink, budget);
+            failed = false;
+        }
+        catch (const std::exception& e)
+        {
+            VCA_EXCEPTION(e) << e.what();
+        }
+        catch (...)
+        {
+            VCA_ERROR << "Unknown exception";
+        }
+        state.failed.store(failed);
+        state.finished_job.store(job, std::memory_order_release);
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace vca
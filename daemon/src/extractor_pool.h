@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tokenizer.h"
+
+namespace vca
+{
+
+// Runs tokenizers in worker processes so that a document crashing or hanging
+// a parser cannot take down the daemon. Each worker serves one job at a time
+// and hands its tokens back through a ring buffer in shared memory. Workers
+// are started on demand and restarted after they crashed or were killed for
+// running past their deadline or memory limit
+class ExtractorPool
+{
+public:
+    // Workers whose resident memory grows past max_memory_byte_count are
+    // killed, on Linux only. 0 means no limit
+    ExtractorPool(size_t worker_count, size_t max_memory_byte_count);
+
+    VCA_DELETE_COPY(ExtractorPool)
+    VCA_DELETE_MOVE(ExtractorPool)
+
+    ~ExtractorPool();
+
+    // Extracts the file with the worker's tokenizer of the given key within
+    // the limits of the budget. Cancelling the budget cancels the worker's,
+    // too. The tokens pushed before a worker crashed or was killed are kept
+    void
+    extract(const std::string& tokenizer,
+            const Path& file,
+            TokenSink& sink,
+            const ExtractionBudget& budget);
+
+private:
+    class Worker;
+
+    size_t m_max_memory_byte_count;
+    std::mutex m_mutex;
+    std::condition_variable m_cond_var;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<Worker*> m_idle_workers;
+};
+
+// Extracts files in a worker of the pool with the worker's tokenizer of the
+// given key
+class SandboxedTokenizer : public Tokenizer
+{
+public:
+    SandboxedTokenizer(ExtractorPool& pool, std::string key, std::string name);
+
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
+
+private:
+    ExtractorPool& m_pool;
+    std::string m_key;
+    std::string m_name;
+};
+
+// Checks whether the process was started as a worker of an extractor pool
+bool
+is_extractor(int argc, char** argv);
+
+// Serves the jobs of the pool that started this process with the tokenizers
+// by key until the pool goes away. Returns the exit code of the process
+int
+run_extractor(int argc,
+              char** argv,
+              const std::map<std::string, std::unique_ptr<Tokenizer>>&
+                  tokenizers);
+
+} // namespace vca
@@ -0,0 +1,453 @@
+#include "file_poller.h"
+
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <thread>
+
+#include <vca/logging.h>
+#include <vca/time.h>
+
+namespace vca
+{
+
+namespace
+{
+
+constexpr size_t g_poll_interval_s = 60;
+constexpr size_t g_max_batch_size = 256;
+
+// The smallest string sorting after all strings starting with the given dir
+std::string
+dir_end(std::string dir)
+{
+    ++dir.back(); // the trailing separator
+    return dir;
+}
+
+// Polls a root dir on a share that doesn't support file watching. A snapshot
+// of the mtimes of all dirs is kept so that a poll costs a stat per dir. Only
+// dirs whose mtime changed, i.e. that had entries added, removed or renamed,
+// are listed and only their files with a changed size or mtime are processed
+struct Poller
+{
+    Poller(CommandQueue& commands,
+           Path root_dir,
+           IgnoreRules exclusions,
+           UserDb& user_db,
+           const FileProcessor& file_processor)
+        : commands{commands}
+        , root_dir{std::move(root_dir)}
+        , ignore_resolver{this->root_dir, std::move(exclusions)}
+        , user_db{user_db}
+        , file_processor{file_processor}
+    {
+        VCA_CHECK(this->root_dir.exists())
+            << "root_dir does not exist: " << this->root_dir;
+        VCA_INFO << "Adding poller for: " << this->root_dir;
+        thread = std::thread{[this] { run(); }};
+    }
+
+    ~Poller()
+    {
+        done = true;
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    // called from poll thread
+    void
+    run()
+    {
+        try
+        {
+            auto snapshot = commands.push(
+                [&user_db = user_db, root_dir = root_dir] {
+                    return user_db.list_dirs(root_dir);
+                });
+            if (!wait(snapshot, done))
+            {
+                return;
+            }
+            dirs = snapshot.get();
+            while (sleep())
+            {
+                poll();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            VCA_EXCEPTION(e) << e.what();
+        }
+        catch (...)
+        {
+            VCA_ERROR << "Unknown exception";
+        }
+    }
+
+    bool
+    sleep() const
+    {
+        Timer timer;
+        while (timer.us() < g_poll_interval_s * 1000000)
+        {
+            if (done)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+        return !done;
+    }
+
+    void
+    poll()
+    {
+        if (!root_dir.exists())
+        {
+            VCA_WARN << "root_dir not available: " << root_dir;
+            return;
+        }
+        Timer timer;
+        poll_time = static_cast<uint64_t>(std::time(nullptr));
+        size_t dir_count = 0;
+        // dirs to list, growing as new dirs are found
+        std::vector<std::string> changed;
+        if (dirs.find(std::string{}) == dirs.end())
+        {
+            changed.emplace_back();
+        }
+        for (auto it = dirs.begin(); it != dirs.end() && !done;)
+        {
+            ++dir_count;
+            uint64_t mtime;
+            if (!dir_mtime(it->first, mtime))
+            {
+                if (it->first.empty())
+                {
+                    return;
+                }
+                it = remove_dir(it->first);
+                continue;
+            }
+            if (mtime != it->second)
+            {
+                changed.emplace_back(it->first);
+            }
+            ++it;
+        }
+        for (size_t i = 0; i < changed.size() && !done; ++i)
+        {
+            // copied as listing adds to changed
+            const auto dir = changed[i];
+            list_dir(dir, changed);
+        }
+        if (done)
+        {
+            return;
+        }
+        commit();
+        VCA_DEBUG << "Polling finished: " << root_dir
+                  << " - Dirs: " << dir_count << ", listed: " << changed.size()
+                  << " - Took: " << us_to_s(timer.us()) << " s";
+    }
+
+    bool
+    dir_mtime(const std::string& dir, uint64_t& mtime) const
+    {
+        try
+        {
+            mtime = (root_dir / Path{dir}).last_write_time();
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    // Lists a new or changed dir and reconciles its files with the index
+    void
+    list_dir(const std::string& dir, std::vector<std::string>& changed)
+    {
+        constexpr auto separator =
+            static_cast<char>(std::filesystem::path::preferred_separator);
+
+        uint64_t mtime;
+        if (!dir_mtime(dir, mtime))
+        {
+            if (!dir.empty())
+            {
+                remove_dir(dir);
+            }
+            return;
+        }
+        const auto path = root_dir / Path{dir};
+        std::set<std::string> child_dirs;
+        std::map<std::string, Path> files;
+        std::error_code ec;
+        for (auto it = make_dir_iterator(path, ec);
+             !ec && it != std::filesystem::directory_iterator{};
+             it.increment(ec))
+        {
+            std::error_code type_ec;
+            const auto is_symlink = it->is_symlink(type_ec);
+            const auto is_dir = !is_symlink && it->is_directory(type_ec);
+            if (!is_dir && !is_symlink && !it->is_regular_file(type_ec))
+            {
+                continue;
+            }
+            Path entry{it->path()};
+            if (ignore_resolver.is_ignored(entry, is_dir) ||
+                (is_symlink && !entry.is_file()))
+            {
+                continue;
+            }
+            auto key = dir + it->path().filename().u8string();
+            if (is_dir)
+            {
+                child_dirs.emplace(key + separator);
+            }
+            else
+            {
+                files.emplace(std::move(key), std::move(entry));
+            }
+        }
+        if (ec)
+        {
+            // keep the old mtime so that it's listed again
+            VCA_WARN << "Cannot list dir: " << path << " - " << ec.message();
+            return;
+        }
+        if (files.count(dir + ignore_file_name()) > 0)
+        {
+            ignore_resolver.clear();
+        }
+
+        // dirs gone from the listing, and new ones which are listed in turn
+        std::vector<std::string> removed_dirs;
+        const auto end =
+            dir.empty() ? dirs.end() : dirs.lower_bound(dir_end(dir));
+        for (auto it = dirs.upper_bound(dir); it != end; ++it)
+        {
+            const auto& key = it->first;
+            if (key.find(separator, dir.size()) == key.size() - 1 &&
+                child_dirs.count(key) == 0)
+            {
+                removed_dirs.emplace_back(key);
+            }
+        }
+        for (const auto& key : removed_dirs)
+        {
+            remove_dir(key);
+        }
+        for (const auto& key : child_dirs)
+        {
+            if (dirs.emplace(key, 0).second)
+            {
+                changed.emplace_back(key);
+            }
+        }
+
+        auto indexed = commands.push(
+            [&user_db = user_db, root_dir = root_dir, dir = dir] {
+                return user_db.list_dir_files(root_dir, dir);
+            });
+        if (!wait(indexed, done))
+        {
+            return;
+        }
+        for (const auto& file : indexed.get())
+        {
+            const auto it = files.find(file.path);
+            if (it == files.end())
+            {
+                batch.removed_files.emplace_back(root_dir / Path{file.path});
+            }
+            else if (!is_modified(it->second, file.fingerprint))
+            {
+                files.erase(it);
+            }
+        }
+        for (auto& [key, file] : files)
+        {
+            update(std::move(file));
+        }
+
+        // the mtime only has a resolution of seconds so changes made in the
+        // same second as the listing would go unnoticed
+        if (mtime + 1 >= poll_time)
+        {
+            mtime = 0;
+        }
+        dirs[dir] = mtime;
+        batch.updated_dirs.emplace_back(dir, mtime);
+        if (batch.updated_files.size() + batch.removed_files.size() >=
+            g_max_batch_size)
+        {
+            commit();
+        }
+    }
+
+    // Drops the snapshot of a dir and its subtree. Returns the iterator
+    // past the subtree
+    std::map<std::string, uint64_t>::iterator
+    remove_dir(const std::string& dir)
+    {
+        batch.removed_dirs.emplace_back(dir);
+        return dirs.erase(dirs.lower_bound(dir),
+                          dirs.lower_bound(dir_end(dir)));
+    }
+
+    static bool
+    is_modified(const Path& path, const Fingerprint& fingerprint)
+    {
+        try
+        {
+            return path.size() != fingerprint.size() ||
+                path.last_write_time() != fingerprint.last_write_time();
+        }
+        catch (const std::exception&)
+        {
+            return true;
+        }
+    }
+
+    void
+    update(Path path)
+    {
+        vca::FileContents contents;
+        try
+        {
+            contents = file_processor.process(path, counter, &done);
+            path.compute_fingerprint();
+        }
+        catch (const std::exception& e)
+        {
+            // skip file
+            VCA_EXCEPTION(e) << e.what();
+            return;
+        }
+        if (done)
+        {
+            // the contents may be incomplete
+            return;
+        }
+        batch.updated_files.emplace_back(std::move(path), std::move(contents));
+    }
+
+    void
+    commit()
+    {
+        commands.push([&user_db = user_db,
+                       root_dir = root_dir,
+                       batch = std::move(batch)] {
+            user_db.commit_poll(root_dir, batch);
+        });
+        batch = {};
+    }
+
+    CommandQueue& commands;
+    Path root_dir;
+    IgnoreResolver ignore_resolver;
+    UserDb& user_db;
+    const FileProcessor& file_processor;
+    TokenCounter counter;
+    // the mtimes of the dirs by their relative paths
+    std::map<std::string, uint64_t> dirs;
+    uint64_t poll_time = 0;
+    PollBatch batch;
+    std::atomic<bool> done{false};
+    std::thread thread;
+};
+
+} // namespace
+
+struct FilePoller::Impl final : UserConfig::Observer
+{
+    Impl(CommandQueue& commands,
+         UserConfig& user_config,
+         UserDb& user_db,
+         const FileProcessor& file_processor)
+        : commands{commands}
+        , user_config{user_config}
+        , user_db{user_db}
+        , file_processor{file_processor}
+    {
+        user_config.add_observer(*this);
+        user_config_changed(user_config);
+    }
+
+    ~Impl()
+    {
+        user_config.remove_observer(*this);
+    }
+
+    void
+    user_config_changed(const UserConfig&) override
+    {
+        if (user_config.exclusions() != exclusions)
+        {
+            pollers.clear();
+            exclusions = user_config.exclusions();
+        }
+        // find dirs that don't need polling anymore
+        std::set<Path> trash;
+        for (const auto& [dir, p] : pollers)
+        {
+            if (user_config.polled_dirs().find(dir) ==
+                user_config.polled_dirs().end())
+            {
+                trash.emplace(dir);
+            }
+        }
+        for (const auto& dir : trash)
+        {
+            pollers.erase(dir);
+        }
+        // add new dirs that need polling
+        for (const auto& dir : user_config.polled_dirs())
+        {
+            if (pollers.find(dir) == pollers.end())
+            {
+                user_db.add_root_dir(dir);
+                try
+                {
+                    pollers.emplace(dir,
+                                    std::make_unique<Poller>(commands,
+                                                             dir,
+                                                             exclusions,
+                                                             user_db,
+                                                             file_processor));
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+    }
+
+    CommandQueue& commands;
+    UserConfig& user_config;
+    UserDb& user_db;
+    const FileProcessor& file_processor;
+    IgnoreRules exclusions;
+    std::map<Path, std::unique_ptr<Poller>> pollers;
+};
+
+FilePoller::FilePoller(CommandQueue& commands,
+                       UserConfig& user_config,
+                       UserDb& user_db,
+                       const FileProcessor& file_processor)
+    : m_impl{std::make_unique<Impl>(commands,
+                                    user_config,
+                                    user_db,
+                                    file_processor)}
+{
+}
+
+FilePoller::~FilePoller() = default;
+
+} // namespace vca
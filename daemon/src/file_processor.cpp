@@ -1,7 +1,6 @@
 #include "file_processor.h"
 
 #include <fstream>
-#include <set>
 
 #include <vca/logging.h>
 #include <vca/string.h>
@@ -12,69 +11,204 @@ namespace vca
 namespace
 {
 
-std::set<String>
-tokenize_filename(String stem, const String& ext)
+void
+tokenize_filename(const std::string& stem, const String& ext, TokenSink& sink)
 {
-    replace_all(stem, special_chars(), space_char());
-    std::list<String> tokens;
-    split(tokens, stem, vca::space_char());
-    tokens.emplace_back(ext);
-    return {tokens.begin(), tokens.end()};
+    split_words(stem, sink);
+    sink.push(wide_to_narrow(ext));
 }
 
+constexpr size_t g_max_cached_byte_count = 64 * 1024 * 1024;
+
 } // namespace
 
-FileProcessor::FileProcessor(const AppConfig& app_config)
+FileProcessor::FileProcessor(const AppConfig& app_config,
+                             UserConfig& user_config)
     : m_app_config{app_config}
+    , m_user_config{user_config}
+    , m_cache{g_max_cached_byte_count}
+{
+    m_user_config.add_observer(*this);
+}
+
+FileProcessor::~FileProcessor()
 {
+    m_user_config.remove_observer(*this);
+}
+
+void
+FileProcessor::user_config_changed(const UserConfig& user_config)
+{
+    std::map<std::string, ExtractionLimits> limits;
+    const auto add_limits = [&](const std::unique_ptr<Tokenizer>& tokenizer) {
+        if (tokenizer)
+        {
+            const auto name = tokenizer->name();
+            limits.emplace(name, user_config.extraction_limits(name));
+        }
+    };
+    add_limits(m_default_tokenizer);
+    for (const auto& [ext, tokenizer] : m_tokenizers)
+    {
+        add_limits(tokenizer);
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_limits_mutex};
+        m_limits = std::move(limits);
+    }
+    // the terms cached may have been cut off by other limits
+    m_cache.clear();
 }
 
 void
 FileProcessor::set_default_tokenizer(std::unique_ptr<Tokenizer> tokenizer)
 {
     m_default_tokenizer = std::move(tokenizer);
+    user_config_changed(m_user_config);
 }
 
 void
 FileProcessor::add_tokenizer(String ext, std::unique_ptr<Tokenizer> tokenizer)
 {
     m_tokenizers.emplace(std::move(ext), std::move(tokenizer));
+    user_config_changed(m_user_config);
 }
 
-std::vector<std::string>
-FileProcessor::process(const Path& file) const
+FileContents
+FileProcessor::process(const Path& file,
+                       TokenCounter& counter,
+                       const std::atomic<bool>* const cancelled) const
 {
-    const auto stem = file.filename().stem().to_wide();
+    const auto stem = file.filename().stem().to_narrow();
     auto ext = file.extension().to_wide();
     to_lower_case(ext);
 
-    auto words = tokenize_filename(stem, ext);
-
-    const auto tokenizer = find_tokenizer(ext);
+    FileContents text;
+    const auto tokenizer = find_tokenizer(ext, sniff_content(file, ext));
     if (tokenizer)
     {
-        const auto tokens = tokenizer->extract(file);
-        words.insert(tokens.begin(), tokens.end());
+        try
+        {
+            text = extract(*tokenizer, file, counter, cancelled);
+        }
+        catch (const std::exception& e)
+        {
+            // the content may have been sniffed wrong, e.g. a text file
+            // quoting a pdf header
+            const auto fallback = find_tokenizer(ext, ContentType::Text);
+            if (!fallback || fallback == tokenizer)
+            {
+                throw;
+            }
+            VCA_WARN << "Extracting " << file << " with " << tokenizer->name()
+                     << " failed, falling back to " << fallback->name()
+                     << ": " << e.what();
+            text = extract(*fallback, file, counter, cancelled);
+        }
     }
 
-    std::vector<std::string> result;
-    result.reserve(words.size());
-    for (const auto& w : words)
+    // the words of the file name come first
+    counter.clear();
+    tokenize_filename(stem, ext, counter);
+    FileContents contents;
+    for (const auto& term : counter.terms())
     {
-        result.emplace_back(wide_to_narrow(w));
+        contents.add(term.term, term.frequency, term.first_position);
     }
-    return result;
+    counter.clear();
+    contents.end_name();
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        contents.add(text[i], text.frequency(i), text.first_position(i));
+    }
+    return contents;
+}
+
+FileContents
+FileProcessor::extract(const Tokenizer& tokenizer,
+                       const Path& file,
+                       TokenCounter& counter,
+                       const std::atomic<bool>* const cancelled) const
+{
+    const auto key = m_cache.key(file, tokenizer);
+    if (auto text = m_cache.find(key))
+    {
+        return std::move(*text);
+    }
+
+    counter.clear();
+    ExtractionBudget budget{extraction_limits(tokenizer), cancelled};
+    tokenizer.extract(file, counter, budget);
+    // sorted so that the same text always yields the same contents
+    FileContents text;
+    for (const auto& term : counter.terms(true))
+    {
+        text.add(term.term, term.frequency, term.first_position);
+    }
+    if (!budget.cancelled())
+    {
+        m_cache.insert(key, text);
+    }
+    return text;
+}
+
+ExtractionLimits
+FileProcessor::extraction_limits(const Tokenizer& tokenizer) const
+{
+    std::lock_guard<std::mutex> lock{m_limits_mutex};
+    const auto limits = m_limits.find(tokenizer.name());
+    VCA_CHECK(limits != m_limits.end());
+    return limits->second;
 }
 
 const Tokenizer*
-FileProcessor::find_tokenizer(const String& ext) const
+FileProcessor::find_tokenizer(const String& ext, const ContentType type) const
 {
+    // formats with a signature are tokenized as such whatever their extension
+    String content_ext;
+    switch (type)
+    {
+    case ContentType::Binary:
+        return nullptr;
+    case ContentType::Pdf:
+        content_ext = U".pdf";
+        break;
+    case ContentType::Rtf:
+        content_ext = U".rtf";
+        break;
+    case ContentType::Xml:
+    case ContentType::Text:
+    case ContentType::Zip:
+        break;
+    }
+    if (!content_ext.empty() && content_ext != ext)
+    {
+        const auto tokenizer = m_tokenizers.find(content_ext);
+        return tokenizer != m_tokenizers.end() ? tokenizer->second.get()
+                                               : nullptr;
+    }
     const auto tokenizer = m_tokenizers.find(ext);
     if (tokenizer != m_tokenizers.end())
     {
         return tokenizer->second.get();
     }
-    return m_default_tokenizer.get();
+    switch (type)
+    {
+    case ContentType::Xml:
+    {
+        const auto xml_tokenizer = m_tokenizers.find(U".xml");
+        if (xml_tokenizer != m_tokenizers.end())
+        {
+            return xml_tokenizer->second.get();
+        }
+        return m_default_tokenizer.get();
+    }
+    case ContentType::Text:
+        return m_default_tokenizer.get();
+    default:
+        // e.g. an archive not known by its extension
+        return nullptr;
+    }
 }
 
 } // namespace vca
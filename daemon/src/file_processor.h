@@ -1,20 +1,34 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include <vca/config.h>
 #include <vca/filesystem.h>
+#include <vca/userdb.h>
 
+#include "content_sniffer.h"
+#include "extraction_cache.h"
 #include "tokenizer.h"
 
 namespace vca
 {
 
-class FileProcessor
+// Called from multiple threads except for adding tokenizers
+class FileProcessor : public UserConfig::Observer
 {
 public:
-    explicit FileProcessor(const AppConfig& app_config);
+    FileProcessor(const AppConfig& app_config, UserConfig& user_config);
+
+    VCA_DELETE_COPY(FileProcessor)
+    VCA_DELETE_MOVE(FileProcessor)
+
+    ~FileProcessor();
+
+    void
+    user_config_changed(const UserConfig& user_config) override;
 
     void
     set_default_tokenizer(std::unique_ptr<Tokenizer> tokenizer);
@@ -22,16 +36,35 @@ public:
     void
     add_tokenizer(String ext, std::unique_ptr<Tokenizer> tokenizer);
 
-    std::vector<std::string>
-    process(const Path& file) const;
+    // The counter is scratch space reused by the calling thread. Setting
+    // cancelled stops the extraction early, the contents are incomplete then
+    FileContents
+    process(const Path& file,
+            TokenCounter& counter,
+            const std::atomic<bool>* cancelled = nullptr) const;
 
 private:
     const Tokenizer*
-    find_tokenizer(const String& ext) const;
+    find_tokenizer(const String& ext, ContentType type) const;
+
+    // Returns the terms of the file's text, taken from the cache for copies
+    // of a file processed before
+    FileContents
+    extract(const Tokenizer& tokenizer,
+            const Path& file,
+            TokenCounter& counter,
+            const std::atomic<bool>* cancelled) const;
+
+    ExtractionLimits
+    extraction_limits(const Tokenizer& tokenizer) const;
 
     const AppConfig& m_app_config;
+    UserConfig& m_user_config;
+    mutable std::mutex m_limits_mutex;
+    std::map<std::string, ExtractionLimits> m_limits;
     std::unique_ptr<Tokenizer> m_default_tokenizer;
     std::map<String, std::unique_ptr<Tokenizer>> m_tokenizers;
+    mutable ExtractionCache m_cache;
 };
 
 } // namespace vca
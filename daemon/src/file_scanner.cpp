@@ -4,6 +4,7 @@
 #include <map>
 #include <thread>
 
+#include <vca/dir_walker.h>
 #include <vca/logging.h>
 #include <vca/time.h>
 
@@ -13,15 +14,92 @@ namespace vca
 namespace
 {
 
+constexpr size_t g_index_page_size = 1024;
+constexpr size_t g_max_batch_size = 256;
+constexpr size_t g_checkpoint_interval_us = 1000000;
+
+// Pages through the index of a root dir in path order. The pages are fetched
+// on the main thread through the command queue
+class IndexCursor
+{
+public:
+    IndexCursor(CommandQueue& commands,
+                const UserDb& user_db,
+                Path root_dir,
+                std::string from,
+                const std::atomic<bool>& done)
+        : m_commands{commands}
+        , m_user_db{user_db}
+        , m_root_dir{std::move(root_dir)}
+        , m_done{done}
+    {
+        fetch(std::move(from));
+    }
+
+    bool
+    valid() const
+    {
+        return m_index < m_files.size();
+    }
+
+    const IndexedFile&
+    current() const
+    {
+        return m_files[m_index];
+    }
+
+    void
+    next()
+    {
+        ++m_index;
+        if (m_index == m_files.size() && m_files.size() == g_index_page_size)
+        {
+            // the next page starts with the last file of this one
+            auto last = std::move(m_files.back().path);
+            fetch(last);
+            if (valid() && current().path == last)
+            {
+                ++m_index;
+            }
+        }
+    }
+
+private:
+    void
+    fetch(std::string from)
+    {
+        auto future = m_commands.push([&user_db = m_user_db,
+                                       root_dir = m_root_dir,
+                                       from = std::move(from)] {
+            return user_db.list_files(root_dir, from, g_index_page_size);
+        });
+        m_files.clear();
+        m_index = 0;
+        if (wait(future, m_done))
+        {
+            m_files = future.get();
+        }
+    }
+
+    CommandQueue& m_commands;
+    const UserDb& m_user_db;
+    Path m_root_dir;
+    const std::atomic<bool>& m_done;
+    std::vector<IndexedFile> m_files;
+    size_t m_index = 0;
+};
+
 struct Scanner
 {
 
     Scanner(CommandQueue& commands,
             Path root_dir,
+            IgnoreRules exclusions,
             UserDb& user_db,
             const FileProcessor& file_processor)
         : commands{commands}
         , root_dir{std::move(root_dir)}
+        , exclusions{std::move(exclusions)}
         , user_db{user_db}
         , file_processor{file_processor}
     {
@@ -50,36 +128,81 @@ struct Scanner
                 VCA_ERROR << "root_dir does not exist: " << root_dir;
                 return;
             }
-            VCA_INFO << "Scanning: " << root_dir;
+            batch.exclusions = exclusions.patterns();
+            auto checkpoint =
+                commands.push([&user_db = user_db,
+                               root_dir = root_dir,
+                               exclusions = batch.exclusions] {
+                    return user_db.scan_checkpoint(root_dir, exclusions);
+                });
+            if (!wait(checkpoint, done))
+            {
+                return;
+            }
+            batch.checkpoint = checkpoint.get();
+            if (batch.checkpoint.empty())
+            {
+                VCA_INFO << "Scanning: " << root_dir;
+            }
+            else
+            {
+                VCA_INFO << "Resuming scan: " << root_dir
+                         << " - After: " << batch.checkpoint;
+            }
             Timer timer;
-            for (const auto& p : make_rec_dir_iterator(root_dir))
+            // Merge the sorted listing on disk with the sorted index to find
+            // added, updated, and deleted files in a single pass
+            IndexCursor index{commands,
+                              user_db,
+                              root_dir,
+                              resume_from(batch.checkpoint),
+                              done};
+            DirWalker walker{root_dir, exclusions, batch.checkpoint};
+            while (!done && walker.next())
             {
-                if (done)
+                while (index.valid() &&
+                       index.current().path < walker.relative())
                 {
-                    break;
+                    remove(index.current().path);
+                    index.next();
                 }
-                auto path = Path{p.path()};
-                if (path.is_file())
+                if (walker.completed_dir() != batch.checkpoint)
                 {
-                    vca::FileContents contents;
-                    try
+                    batch.checkpoint = walker.completed_dir();
+                    if (!is_empty(batch) ||
+                        checkpoint_timer.us() > g_checkpoint_interval_us)
                     {
-                        contents.words = file_processor.process(path);
+                        commit();
                     }
-                    catch (const std::exception& e)
+                }
+                if (index.valid() && index.current().path == walker.relative())
+                {
+                    const auto modified =
+                        is_modified(walker.path(), index.current().fingerprint);
+                    index.next();
+                    if (!modified)
                     {
-                        // skip file
-                        VCA_EXCEPTION(e) << e.what();
                         continue;
                     }
-                    path.compute_fingerprint();
-                    commands.push([this,
-                                   path = std::move(path),
-                                   contents = std::move(contents)] {
-                        user_db.update_file(path, contents);
-                    });
                 }
+                update(walker.path());
+                if (batch.updated_files.size() + batch.removed_files.size() >=
+                    g_max_batch_size)
+                {
+                    commit();
+                }
+            }
+            while (!done && index.valid())
+            {
+                remove(index.current().path);
+                index.next();
+            }
+            if (done)
+            {
+                return;
             }
+            batch.checkpoint.clear();
+            commit();
             VCA_INFO << "Scanning finished: " << root_dir
                      << " - Took: " << us_to_s(timer.us()) << " s";
         }
@@ -93,10 +216,92 @@ struct Scanner
         }
     }
 
+    // Everything sorting before the end of the completed dir is done
+    static std::string
+    resume_from(std::string checkpoint)
+    {
+        if (!checkpoint.empty())
+        {
+            ++checkpoint.back(); // the trailing separator
+        }
+        return checkpoint;
+    }
+
+    static bool
+    is_modified(const Path& path, const Fingerprint& fingerprint)
+    {
+        try
+        {
+            return path.size() != fingerprint.size() ||
+                path.last_write_time() != fingerprint.last_write_time();
+        }
+        catch (const std::exception&)
+        {
+            return true;
+        }
+    }
+
+    static bool
+    is_empty(const ScanBatch& batch)
+    {
+        return batch.updated_files.empty() && batch.removed_files.empty();
+    }
+
+    void
+    update(Path path)
+    {
+        vca::FileContents contents;
+        try
+        {
+            contents = file_processor.process(path, counter, &done);
+            path.compute_fingerprint();
+        }
+        catch (const std::exception& e)
+        {
+            // skip file
+            VCA_EXCEPTION(e) << e.what();
+            return;
+        }
+        if (done)
+        {
+            // the contents may be incomplete
+            return;
+        }
+        batch.updated_files.emplace_back(std::move(path), std::move(contents));
+    }
+
+    void
+    remove(const std::string& relative)
+    {
+        batch.removed_files.emplace_back(root_dir / Path{relative});
+    }
+
+    // The batch is committed together with the checkpoint of the scan so that
+    // a restarted scan can resume from where the index left off
+    void
+    commit()
+    {
+        auto checkpoint = batch.checkpoint;
+        auto exclusions = batch.exclusions;
+        commands.push([&user_db = user_db,
+                       root_dir = root_dir,
+                       batch = std::move(batch)] {
+            user_db.commit_scan(root_dir, batch);
+        });
+        batch = {};
+        batch.checkpoint = std::move(checkpoint);
+        batch.exclusions = std::move(exclusions);
+        checkpoint_timer = Timer{};
+    }
+
     CommandQueue& commands;
     Path root_dir;
+    IgnoreRules exclusions;
     UserDb& user_db;
     const FileProcessor& file_processor;
+    TokenCounter counter;
+    ScanBatch batch;
+    Timer checkpoint_timer;
     std::atomic<bool> done{false};
     std::thread thread;
 };
@@ -126,6 +331,14 @@ struct FileScanner::Impl : public UserConfig::Observer
     void
     user_config_changed(const UserConfig&) override
     {
+        if (user_config.exclusions() != exclusions)
+        {
+            // rescan everything from the start so that the files excluded
+            // now are removed from the index, the checkpoints of the scans
+            // stopped are only valid for the old exclusions
+            scanners.clear();
+            exclusions = user_config.exclusions();
+        }
         // find dirs that don't need scanning anymore
         std::set<Path> trash;
         for (const auto& [dir, s] : scanners)
@@ -151,8 +364,11 @@ struct FileScanner::Impl : public UserConfig::Observer
                 {
                     scanners.emplace(
                         dir,
-                        std::make_unique<Scanner>(
-                            commands, dir, user_db, file_processor));
+                        std::make_unique<Scanner>(commands,
+                                                  dir,
+                                                  exclusions,
+                                                  user_db,
+                                                  file_processor));
                 }
                 catch (...)
                 {
@@ -165,6 +381,7 @@ struct FileScanner::Impl : public UserConfig::Observer
     UserDb& user_db;
     const FileProcessor& file_processor;
     UserConfig& user_config;
+    IgnoreRules exclusions;
     std::map<Path, std::unique_ptr<Scanner>> scanners;
 }; // namespace vca
 
@@ -16,10 +16,12 @@ struct Watcher : efsw::FileWatchListener
 {
     Watcher(CommandQueue& commands,
             Path root_dir,
+            IgnoreRules exclusions,
             UserDb& user_db,
             const FileProcessor& file_processor)
         : commands{commands}
         , root_dir{std::move(root_dir)}
+        , ignore_resolver{this->root_dir, std::move(exclusions)}
         , user_db{user_db}
         , file_processor{file_processor}
     {
@@ -45,15 +47,18 @@ struct Watcher : efsw::FileWatchListener
                      const std::string old_filename = "")
     {
         auto path = Path{dir} / Path{filename};
+        if (path.filename() == Path{ignore_file_name()})
+        {
+            ignore_resolver.clear();
+        }
         switch (action)
         {
         case efsw::Actions::Add:
         case efsw::Actions::Modified:
         {
-            if (path.is_file())
+            if (!ignore_resolver.is_ignored(path, false) && path.is_file())
             {
-                vca::FileContents contents;
-                contents.words = file_processor.process(path);
+                auto contents = file_processor.process(path, counter);
                 path.compute_fingerprint();
                 commands.push([this,
                                path = std::move(path),
@@ -65,7 +70,7 @@ struct Watcher : efsw::FileWatchListener
         }
         case efsw::Actions::Delete:
         {
-            if (path.is_file())
+            if (!ignore_resolver.is_ignored(path, false) && path.is_file())
             {
                 commands.push([this, path = std::move(path)] {
                     user_db.remove_file(path);
@@ -76,7 +81,13 @@ struct Watcher : efsw::FileWatchListener
         case efsw::Actions::Moved:
         {
             auto old_path = Path{dir} / Path{old_filename};
-            if (old_path.is_file())
+            if (ignore_resolver.is_ignored(path, false))
+            {
+                commands.push([this, old_path = std::move(old_path)] {
+                    user_db.remove_file(old_path);
+                });
+            }
+            else if (old_path.is_file())
             {
                 if (path.is_file())
                 {
@@ -102,8 +113,10 @@ struct Watcher : efsw::FileWatchListener
 
     CommandQueue& commands;
     Path root_dir;
+    IgnoreResolver ignore_resolver;
     UserDb& user_db;
     const FileProcessor& file_processor;
+    TokenCounter counter;
     efsw::FileWatcher file_watcher;
     efsw::WatchID watch;
 };
@@ -133,6 +146,11 @@ struct FileWatcher::Impl final : UserConfig::Observer
     void
     user_config_changed(const UserConfig&) override
     {
+        if (user_config.exclusions() != exclusions)
+        {
+            watchers.clear();
+            exclusions = user_config.exclusions();
+        }
         // find dirs that don't need watching anymore
         std::set<Path> trash;
         for (const auto& [dir, s] : watchers)
@@ -148,18 +166,27 @@ struct FileWatcher::Impl final : UserConfig::Observer
             watchers.erase(dir);
             user_db.remove_root_dir(dir);
         }
+        // polled dirs are left to the file poller
+        for (const auto& dir : user_config.polled_dirs())
+        {
+            watchers.erase(dir);
+        }
         // add new dirs that need watching
         for (const auto& dir : user_config.root_dirs())
         {
-            if (watchers.find(dir) == watchers.end())
+            if (watchers.find(dir) == watchers.end() &&
+                user_config.polled_dirs().count(dir) == 0)
             {
                 user_db.add_root_dir(dir);
                 try
                 {
                     watchers.emplace(
                         dir,
-                        std::make_unique<Watcher>(
-                            commands, dir, user_db, file_processor));
+                        std::make_unique<Watcher>(commands,
+                                                  dir,
+                                                  exclusions,
+                                                  user_db,
+                                                  file_processor));
                 }
                 catch (...)
                 {
@@ -172,6 +199,7 @@ struct FileWatcher::Impl final : UserConfig::Observer
     UserConfig& user_config;
     UserDb& user_db;
     const FileProcessor& file_processor;
+    IgnoreRules exclusions;
     std::map<Path, std::unique_ptr<Watcher>> watchers;
 }; // namespace vca
 
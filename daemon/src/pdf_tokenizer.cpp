@@ -1,6 +1,11 @@
 #include "pdf_tokenizer.h"
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <stack>
+#include <unordered_map>
+#include <vector>
 
 #include <vca/logging.h>
 #include <vca/string.h>
@@ -16,231 +21,686 @@ namespace vca
 namespace
 {
 
-constexpr size_t g_max_byte_count = 8192;
+// The most memory the content streams of the pages being parsed may take up,
+// encoded and decoded
+constexpr size_t g_max_memory_byte_count = 64 * 1024 * 1024;
 
-std::string
-get_utf8(PdfFont* font, const PdfString& str)
+// The budget left from which pages are parsed in parallel, smaller budgets
+// are usually used up by the first page
+constexpr size_t g_parallel_byte_count = 64 * 1024;
+
+// Strings shown up to this size are converted once per font
+constexpr size_t g_max_cached_string_size = 32;
+
+// Bounds the memory taken up by the content streams of the pages being parsed,
+// which may be decoded on several threads at once. Only page contents are ever
+// parsed so images and other XObjects are never loaded, but the fonts used stay
+// loaded with the document and are not bounded
+class MemoryCeiling
 {
-    if (!font)
+public:
+    // Returns false if the bytes would exceed the ceiling
+    bool
+    reserve(const size_t byte_count)
     {
-        VCA_WARN << "Got text but no font: " << str.GetString();
-        return {};
+        auto used = m_used.load();
+        do
+        {
+            if (byte_count > g_max_memory_byte_count - used)
+            {
+                return false;
+            }
+        } while (!m_used.compare_exchange_weak(used, used + byte_count));
+        return true;
     }
 
-    if (!font->GetEncoding())
+    void
+    release(const size_t byte_count)
     {
-        VCA_WARN << "Got text but no encoding: " << str.GetString();
-        return {};
+        m_used -= byte_count;
     }
-    const auto unicode = font->GetEncoding()->ConvertToUnicode(str, font);
-    return unicode.GetStringUtf8();
-}
 
-std::list<std::string>
-extract_text(const Path& path)
+private:
+    std::atomic<size_t> m_used{0};
+};
+
+// Collects the decoded data of a stream and fails once the ceiling is
+// reached, so a stream is never decoded in full just to be dropped
+class BoundedOutputStream : public PdfOutputStream
 {
-    size_t byte_count = 0;
-    std::list<std::string> words;
-    PdfMemDocument doc{path.to_narrow().c_str()};
-    const auto n = doc.GetPageCount();
-    for (int i = 0; i < n; i++)
+public:
+    BoundedOutputStream(std::string& data, MemoryCeiling& ceiling)
+        : m_data{data}
+        , m_ceiling{ceiling}
+    {
+    }
+
+    pdf_long
+    Write(const char* buffer, const pdf_long length) override
+    {
+        const auto size = static_cast<size_t>(length);
+        if (!m_ceiling.reserve(size))
+        {
+            m_exceeded = true;
+            PODOFO_RAISE_ERROR(ePdfError_OutOfMemory);
+        }
+        m_data.append(buffer, size);
+        return length;
+    }
+
+    void
+    Close() override
+    {
+    }
+
+    bool
+    exceeded() const
     {
-        const auto page = doc.GetPage(i);
-        const char* token = nullptr;
-        PdfVariant var;
-        EPdfContentsType type;
-        PdfContentsTokenizer tokenizer(page);
+        return m_exceeded;
+    }
 
-        bool is_text = false;
-        PdfFont* font = nullptr;
+private:
+    std::string& m_data;
+    MemoryCeiling& m_ceiling;
+    bool m_exceeded = false;
+};
 
-        std::stack<PdfVariant> stack;
+// An operation of a page that selects a font or shows text
+struct TextOperation
+{
+    enum class Type
+    {
+        // selects the font resource, none if the name is empty
+        Font,
+        // shows a string
+        Text,
+        // shows the strings of a TJ array, which are split at spaces
+        TextArray,
+    };
 
-        while (tokenizer.ReadNext(type, token, var))
+    Type type;
+    PdfName font;
+    std::vector<PdfString> strings;
+};
+
+struct PageText
+{
+    std::vector<TextOperation> operations;
+    // whether decoding the contents hit the memory ceiling
+    bool exceeded = false;
+};
+
+// A content stream copied out of the document, as PoDoFo objects must not be
+// touched on other threads while the document loads more objects on demand
+struct ContentStream
+{
+    // encoded
+    std::string data;
+    TVecFilters filters;
+    // holds a copy of the DecodeParms of the stream, if any
+    PdfDictionary params;
+};
+
+// Drops the loaded data of an object from the document, it is read from the
+// file again if needed
+void
+free_object(PdfObject& object)
+{
+    if (const auto parsed = dynamic_cast<PdfParserObject*>(&object))
+    {
+        parsed->FreeObjectMemory();
+    }
+}
+
+// Copies the encoded data of a stream along with what decoding it takes.
+// Returns false once the ceiling is reached
+bool
+copy_stream(PdfObject& object,
+            MemoryCeiling& ceiling,
+            std::vector<ContentStream>& streams,
+            size_t& reserved)
+{
+    if (!object.HasStream())
+    {
+        return true;
+    }
+    ContentStream stream;
+    BoundedOutputStream output{stream.data, ceiling};
+    try
+    {
+        object.GetStream()->GetCopy(&output);
+    }
+    catch (const PdfError&)
+    {
+        ceiling.release(stream.data.size());
+        if (!output.exceeded())
+        {
+            throw;
+        }
+        return false;
+    }
+    reserved += stream.data.size();
+    stream.filters = PdfFilterFactory::CreateFilterList(&object);
+    const auto params = object.GetIndirectKey(PdfName("DecodeParms"));
+    if (params && params->IsDictionary())
+    {
+        stream.params.AddKey(PdfName("DecodeParms"), *params);
+    }
+    streams.push_back(std::move(stream));
+    return true;
+}
+
+// Copies the content streams of a page out of the document and frees them in
+// the document again. Objects are parsed on demand so only the streams of the
+// pages read are ever loaded. The size of the copies is added to reserved.
+// Returns false once the ceiling is reached
+bool
+copy_contents(PdfPage& page,
+              MemoryCeiling& ceiling,
+              std::vector<ContentStream>& streams,
+              size_t& reserved)
+{
+    streams.clear();
+    const auto object = page.GetObject()->GetIndirectKey(PdfName("Contents"));
+    if (!object)
+    {
+        return true;
+    }
+    std::vector<PdfObject*> objects;
+    if (object->IsArray())
+    {
+        const auto owner = page.GetObject()->GetOwner();
+        for (auto& e : object->GetArray())
+        {
+            objects.push_back(e.IsReference() && owner
+                                  ? owner->GetObject(e.GetReference())
+                                  : &e);
+        }
+    }
+    else
+    {
+        objects.push_back(object);
+    }
+
+    for (const auto stream : objects)
+    {
+        if (!stream || !stream->IsDictionary())
+        {
+            continue;
+        }
+        // check the encoded size before the stream gets loaded
+        const auto length = stream->GetIndirectKey(PdfName::KeyLength);
+        size_t length_byte_count = 0;
+        if (length && length->IsNumber() && length->GetNumber() > 0)
         {
-            if (byte_count > g_max_byte_count)
+            length_byte_count = static_cast<size_t>(length->GetNumber());
+            if (!ceiling.reserve(length_byte_count))
             {
-                return words;
+                return false;
             }
-            switch (type)
+        }
+        const auto copied = copy_stream(*stream, ceiling, streams, reserved);
+        free_object(*stream);
+        ceiling.release(length_byte_count);
+        if (!copied)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes a stream copied out of the document like PdfStream::GetFilteredCopy
+void
+decode(const ContentStream& stream, PdfOutputStream& output)
+{
+    const auto size = static_cast<pdf_long>(stream.data.size());
+    if (stream.filters.empty())
+    {
+        output.Write(stream.data.data(), size);
+        return;
+    }
+    const std::unique_ptr<PdfOutputStream> decoder{
+        PdfFilterFactory::CreateDecodeStream(stream.filters,
+                                             &output,
+                                             &stream.params)};
+    decoder->Write(stream.data.data(), size);
+    decoder->Close();
+}
+
+// Decodes the content streams copied out of a page and collects its text
+// operations. Touches no objects of the document so pages may be parsed in
+// parallel
+PageText
+parse_page(const std::vector<ContentStream>& streams, MemoryCeiling& ceiling)
+{
+    PageText text;
+    std::string contents;
+    for (const auto& stream : streams)
+    {
+        BoundedOutputStream output{contents, ceiling};
+        try
+        {
+            decode(stream, output);
+            // streams of a page are split at token boundaries
+            output.Write("\n", 1);
+        }
+        catch (const PdfError&)
+        {
+            if (!output.exceeded())
             {
-            case ePdfContentsType_Keyword:
+                throw;
+            }
+            text.exceeded = true;
+            break;
+        }
+    }
+
+    const char* token = nullptr;
+    PdfVariant var;
+    EPdfContentsType type;
+    PdfContentsTokenizer tokenizer{contents.data(),
+                                   static_cast<long>(contents.size())};
+
+    bool is_text = false;
+
+    std::stack<PdfVariant> stack;
+
+    const auto add = [&text](const TextOperation::Type type,
+                             PdfName font,
+                             std::vector<PdfString> strings) {
+        text.operations.push_back({type, std::move(font), std::move(strings)});
+    };
+
+    while (tokenizer.ReadNext(type, token, var))
+    {
+        switch (type)
+        {
+        case ePdfContentsType_Keyword:
+        {
+            if (strcmp(token, "l") == 0 || strcmp(token, "m") == 0)
             {
-                if (strcmp(token, "l") == 0 || strcmp(token, "m") == 0)
+                if (stack.size() == 2)
+                {
+                    stack.pop();
+                    stack.pop();
+                }
+                else
                 {
-                    if (stack.size() == 2)
+                    VCA_WARN << "Token '" << token
+                             << "' expects two arguments, but " << stack.size()
+                             << " given; ignoring";
+                    while (!stack.empty())
                     {
                         stack.pop();
-                        stack.pop();
-                    }
-                    else
-                    {
-                        VCA_WARN << "Token '" << token
-                                 << "' expects two arguments, but "
-                                 << stack.size() << " given; ignoring";
-                        while (!stack.empty())
-                        {
-                            stack.pop();
-                        }
                     }
                 }
-                else if (strcmp(token, "BT") == 0)
+            }
+            else if (strcmp(token, "BT") == 0)
+            {
+                is_text = true;
+            }
+            else if (strcmp(token, "ET") == 0)
+            {
+                if (!is_text)
                 {
-                    is_text = true;
+                    VCA_WARN << "Found ET without BT!";
                 }
-                else if (strcmp(token, "ET") == 0)
+            }
+            if (is_text)
+            {
+                if (strcmp(token, "Tf") == 0)
                 {
-                    if (!is_text)
+                    if (stack.size() < 2)
                     {
-                        VCA_WARN << "Found ET without BT!";
+                        VCA_WARN << "Expects two arguments for 'Tf', "
+                                    "ignoring";
+                        add(TextOperation::Type::Font, {}, {});
+                        continue;
                     }
+
+                    stack.pop();
+                    add(TextOperation::Type::Font, stack.top().GetName(), {});
                 }
-                if (is_text)
+                else if (strcmp(token, "Tj") == 0 || strcmp(token, "'") == 0)
                 {
-                    if (strcmp(token, "Tf") == 0)
+                    if (stack.size() < 1)
                     {
-                        if (stack.size() < 2)
-                        {
-                            VCA_WARN << "Expects two arguments for 'Tf', "
-                                        "ignoring";
-                            font = nullptr;
-                            continue;
-                        }
-
-                        stack.pop();
-                        PdfName fontName = stack.top().GetName();
-                        auto f =
-                            page->GetFromResources(PdfName("Font"), fontName);
-                        if (!f)
-                        {
-                            VCA_ERROR << "Cannot create font";
-                            return words;
-                        }
-
-                        font = doc.GetFont(f);
-                        if (!font)
-                        {
-                            VCA_WARN << "Unable to create font for object";
-                        }
+                        VCA_WARN << "Expects one argument for '" << token
+                                 << "', ignoring";
+                        continue;
                     }
-                    else if (strcmp(token, "Tj") == 0 ||
-                             strcmp(token, "'") == 0)
+
+                    add(TextOperation::Type::Text,
+                        {},
+                        {stack.top().GetString()});
+                    stack.pop();
+                }
+                else if (strcmp(token, "\"") == 0)
+                {
+                    if (stack.size() < 3)
                     {
-                        if (stack.size() < 1)
-                        {
-                            VCA_WARN << "Expects one argument for '" << token
-                                     << "', ignoring";
-                            continue;
-                        }
+                        VCA_WARN << "Expects three arguments for '" << token
+                                 << "', ignoring";
 
-                        auto res = get_utf8(font, stack.top().GetString());
-                        if (!res.empty() && res != " ")
+                        while (!stack.empty())
                         {
-                            byte_count += res.size();
-                            words.emplace_back(std::move(res));
+                            stack.pop();
                         }
-                        stack.pop();
+                        continue;
                     }
-                    else if (strcmp(token, "\"") == 0)
-                    {
-                        if (stack.size() < 3)
-                        {
-                            VCA_WARN << "Expects three arguments for '" << token
-                                     << "', ignoring";
-
-                            while (!stack.empty())
-                            {
-                                stack.pop();
-                            }
-                            continue;
-                        }
 
-                        auto res = get_utf8(font, stack.top().GetString());
-                        if (!res.empty() && res != " ")
-                        {
-                            byte_count += res.size();
-                            words.emplace_back(std::move(res));
-                        }
+                    add(TextOperation::Type::Text,
+                        {},
+                        {stack.top().GetString()});
 
-                        stack.pop();
-                        stack.pop(); // remove char spacing from stack
-                        stack.pop(); // remove word spacing from stack
-                    }
-                    else if (strcmp(token, "TJ") == 0)
+                    stack.pop();
+                    stack.pop(); // remove char spacing from stack
+                    stack.pop(); // remove word spacing from stack
+                }
+                else if (strcmp(token, "TJ") == 0)
+                {
+                    if (stack.size() < 1)
                     {
-                        if (stack.size() < 3)
-                        {
-                            VCA_WARN << "Expects one argument for '" << token
-                                     << "', ignoring";
-                            continue;
-                        }
-
-                        const auto array = stack.top().GetArray();
-                        stack.pop();
+                        VCA_WARN << "Expects one argument for '" << token
+                                 << "', ignoring";
+                        continue;
+                    }
 
-                        std::string res;
-                        for (const auto& e : array)
-                        {
-                            if (e.IsString() || e.IsHexString())
-                            {
-                                auto s = get_utf8(font, e.GetString());
-                                if (s != " ")
-                                {
-                                    res += s;
-                                }
-                                else if (!res.empty())
-                                {
-                                    byte_count += res.size();
-                                    words.emplace_back(std::move(res));
-                                    res.clear();
-                                }
-                            }
-                        }
-                        if (!res.empty())
+                    std::vector<PdfString> strings;
+                    for (const auto& e : stack.top().GetArray())
+                    {
+                        if (e.IsString() || e.IsHexString())
                         {
-                            byte_count += res.size();
-                            words.emplace_back(std::move(res));
+                            strings.push_back(e.GetString());
                         }
                     }
+                    stack.pop();
+                    add(TextOperation::Type::TextArray,
+                        {},
+                        std::move(strings));
                 }
             }
+        }
+        break;
+        case ePdfContentsType_Variant:
+        {
+            stack.push(var);
+        }
+        break;
+        case ePdfContentsType_ImageData:
             break;
-            case ePdfContentsType_Variant:
+        }
+    }
+    ceiling.release(contents.size());
+    return text;
+}
+
+// Converts the strings shown to UTF-8. Fonts and the conversions of short
+// strings are memoized for the whole document as the same fonts are used on
+// most pages and the same strings are shown over and over
+class TextConverter
+{
+public:
+    explicit TextConverter(PdfMemDocument& doc)
+        : m_doc{doc}
+    {
+    }
+
+    PdfFont*
+    font(PdfObject* object)
+    {
+        auto& font = m_fonts[object];
+        if (!font)
+        {
+            font = m_doc.GetFont(object);
+            if (!font)
             {
-                stack.push(var);
-            }
-            break;
-            case ePdfContentsType_ImageData:
-                break;
+                VCA_WARN << "Unable to create font for object";
             }
         }
+        return font;
     }
-    return words;
-}
 
-} // namespace
+    std::string
+    utf8(PdfFont* font, const PdfString& str)
+    {
+        if (!font)
+        {
+            VCA_WARN << "Got text but no font: " << str.GetString();
+            return {};
+        }
 
-std::vector<String>
-PdfTokenizer::extract(const Path& file) const
+        if (!font->GetEncoding())
+        {
+            VCA_WARN << "Got text but no encoding: " << str.GetString();
+            return {};
+        }
+        const auto size = static_cast<size_t>(str.GetLength());
+        if (size > g_max_cached_string_size)
+        {
+            return convert(font, str);
+        }
+        auto key = std::string(str.IsUnicode() ? "u" : "b");
+        key.append(str.GetString(), size);
+        auto& strings = m_strings[font];
+        const auto string = strings.find(key);
+        if (string != strings.end())
+        {
+            return string->second;
+        }
+        return strings.emplace(std::move(key), convert(font, str))
+            .first->second;
+    }
+
+private:
+    static std::string
+    convert(PdfFont* font, const PdfString& str)
+    {
+        const auto unicode = font->GetEncoding()->ConvertToUnicode(str, font);
+        return unicode.GetStringUtf8();
+    }
+
+    PdfMemDocument& m_doc;
+    std::unordered_map<const PdfObject*, PdfFont*> m_fonts;
+    std::unordered_map<PdfFont*, std::unordered_map<std::string, std::string>>
+        m_strings;
+};
+
+// Writes the words of a page a line each so that words ending with a hyphen
+// are joined with the next one. Returns false if a font is missing
+bool
+write_page(PdfPage& page,
+           const PageText& text,
+           TextConverter& converter,
+           TokenWriter& writer,
+           ExtractionBudget& budget)
 {
-    auto words = extract_text(file);
-    for (auto w = words.begin(); w != words.end(); ++w)
+    const auto write = [&budget, &writer](const std::string& word) {
+        budget.consume(word.size());
+        writer.write(word);
+        writer.write("\n");
+    };
+    PdfFont* font = nullptr;
+    for (const auto& operation : text.operations)
     {
-        if (w != words.end() && w->size() > 1 && w->back() == '-')
+        if (budget.exhausted())
+        {
+            return true;
+        }
+        switch (operation.type)
+        {
+        case TextOperation::Type::Font:
+            if (operation.font.GetName().empty())
+            {
+                font = nullptr;
+                break;
+            }
+        {
+            const auto object =
+                page.GetFromResources(PdfName("Font"), operation.font);
+            if (!object)
+            {
+                VCA_ERROR << "Cannot create font";
+                return false;
+            }
+            font = converter.font(object);
+        }
+        break;
+        case TextOperation::Type::Text:
+        {
+            const auto res = converter.utf8(font, operation.strings.front());
+            if (!res.empty() && res != " ")
+            {
+                write(res);
+            }
+        }
+        break;
+        case TextOperation::Type::TextArray:
         {
-            auto start = w;
-            ++w;
-            start->erase(start->size() - 1);
-            (*start) += *w;
-            words.erase(w);
+            std::string res;
+            for (const auto& str : operation.strings)
+            {
+                const auto s = converter.utf8(font, str);
+                if (s != " ")
+                {
+                    res += s;
+                }
+                else if (!res.empty())
+                {
+                    write(res);
+                    res.clear();
+                }
+            }
+            if (!res.empty())
+            {
+                write(res);
+            }
+        }
+        break;
         }
     }
-    String one_line;
-    for (const auto& w : words)
+    return true;
+}
+
+void
+extract_text(const Path& path,
+             Async& async,
+             TokenWriter& writer,
+             ExtractionBudget& budget)
+{
+    // only parses the cross-reference table, objects are loaded on demand
+    PdfMemDocument doc;
+    doc.Load(path.to_narrow().c_str());
+    MemoryCeiling ceiling;
+    TextConverter converter{doc};
+    const auto n = doc.GetPageCount();
+    int i = 0;
+    while (i < n && !budget.exhausted())
     {
-        one_line += U" " + narrow_to_wide(w);
+        // objects are loaded and the contents copied out of them on this
+        // thread, only decoding and parsing the copies is spread across the
+        // pool
+        const auto parallel = async.threadCount() > 0 &&
+            budget.available(g_parallel_byte_count) == g_parallel_byte_count;
+        const auto batch_size = parallel ? async.threadCount() : 1;
+        std::vector<PdfPage*> pages;
+        std::vector<std::vector<ContentStream>> streams;
+        size_t reserved = 0;
+        bool loading_exceeded = false;
+        for (; i < n && pages.size() < batch_size; i++)
+        {
+            const auto page = doc.GetPage(i);
+            if (!page)
+            {
+                continue;
+            }
+            streams.emplace_back();
+            if (!copy_contents(*page, ceiling, streams.back(), reserved))
+            {
+                streams.pop_back();
+                loading_exceeded = true;
+                break;
+            }
+            pages.push_back(page);
+        }
+
+        std::vector<std::future<PageText>> texts;
+        for (const auto& page_streams : streams)
+        {
+            const auto parse = [&page_streams, &ceiling] {
+                return parse_page(page_streams, ceiling);
+            };
+            texts.push_back(parallel
+                                ? async.push(parse)
+                                : std::async(std::launch::deferred, parse));
+        }
+
+        // merges the pages in order, all tasks are waited for before the
+        // streams go out of scope
+        std::exception_ptr error;
+        bool exceeded = false;
+        bool font_missing = false;
+        for (size_t j = 0; j < texts.size(); ++j)
+        {
+            try
+            {
+                const auto text = texts[j].get();
+                if (error || exceeded || font_missing)
+                {
+                    continue;
+                }
+                font_missing =
+                    !write_page(*pages[j], text, converter, writer, budget);
+                exceeded = text.exceeded;
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        ceiling.release(reserved);
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if (font_missing)
+        {
+            return;
+        }
+        if (exceeded || loading_exceeded)
+        {
+            VCA_WARN << "Memory ceiling reached, skipping the pages from "
+                     << i + 1 << " on of: " << path;
+            return;
+        }
     }
-    return tokenize(std::move(one_line));
+}
+
+} // namespace
+
+PdfTokenizer::PdfTokenizer(const size_t thread_count)
+    : m_async{thread_count}
+{
+}
+
+std::string
+PdfTokenizer::name() const
+{
+    return "pdf";
+}
+
+void
+PdfTokenizer::extract(const Path& file,
+                      TokenSink& sink,
+                      ExtractionBudget& budget) const
+{
+    TokenWriter writer{sink};
+    extract_text(file, m_async, writer, budget);
+    writer.flush();
 }
 
 } // namespace vca
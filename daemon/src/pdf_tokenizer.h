@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vca/async.h>
+
 #include "tokenizer.h"
 
 namespace vca
@@ -8,10 +10,20 @@ namespace vca
 class PdfTokenizer : public Tokenizer
 {
 public:
-    PdfTokenizer() = default;
+    // Pages of large documents are parsed on a pool of the given number of
+    // threads, which is shared by all extractions
+    explicit PdfTokenizer(size_t thread_count = 0);
+
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
 
-    std::vector<String>
-    extract(const Path& file) const override;
+private:
+    mutable Async m_async;
 };
 
 } // namespace vca
@@ -1,7 +1,5 @@
 #include "tex_tokenizer.h"
 
-#include <fstream>
-
 #include <vca/filesystem.h>
 #include <vca/logging.h>
 
@@ -11,61 +9,74 @@ namespace vca
 namespace
 {
 
-constexpr size_t g_max_byte_count = 81920;
+constexpr size_t g_chunk_size = 65536;
+
+}
 
+std::string
+TexTokenizer::name() const
+{
+    return "tex";
 }
 
-std::vector<String>
-TexTokenizer::extract(const Path& file) const
+void
+TexTokenizer::extract(const Path& file,
+                      TokenSink& sink,
+                      ExtractionBudget& budget) const
 {
-    std::string data;
+    FileReader reader{file};
+    if (!reader.is_open())
     {
-        auto f = make_ifstream(file);
-        try
-        {
-            data = read_text(f, g_max_byte_count);
-        }
-        catch (...)
-        {
-            VCA_DEBUG << "Read text failed for: " << file;
-            return {};
-        }
+        VCA_DEBUG << "Read text failed for: " << file;
+        return;
     }
 
+    TokenWriter writer{sink};
     std::string text;
     bool is_text = true;
-    for (auto c = data.begin(); c != data.end(); ++c)
+    while (const auto max_count = budget.available(g_chunk_size))
     {
-        if (is_text)
+        const auto chunk = reader.read(max_count);
+        if (chunk.empty())
         {
-            if (*c == '\\')
-            {
-                is_text = false;
-            }
+            break;
         }
-        else
+        budget.consume(chunk.size());
+
+        text.clear();
+        for (auto c = chunk.begin(); c != chunk.end(); ++c)
         {
-            if (*c == ' ' || *c == '{' || *c == ']')
+            if (is_text)
             {
-                is_text = true;
-                continue;
+                if (*c == '\\')
+                {
+                    is_text = false;
+                }
             }
-        }
-
-        if (is_text)
-        {
-            if (*c == '{' || *c == '}' || *c == '[' || *c == ']')
+            else
             {
-                text += ' ';
+                if (*c == ' ' || *c == '{' || *c == ']')
+                {
+                    is_text = true;
+                    continue;
+                }
             }
-            else if (*c != '$')
+
+            if (is_text)
             {
-                text += *c;
+                if (*c == '{' || *c == '}' || *c == '[' || *c == ']')
+                {
+                    text += ' ';
+                }
+                else if (*c != '$')
+                {
+                    text += *c;
+                }
             }
         }
+        writer.write(text);
     }
-
-    return tokenize(narrow_to_wide(text));
+    writer.flush();
 }
 
 } // namespace vca
@@ -10,8 +10,13 @@ class TexTokenizer : public Tokenizer
 public:
     TexTokenizer() = default;
 
-    std::vector<String>
-    extract(const Path& file) const override;
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
 };
 
 } // namespace vca
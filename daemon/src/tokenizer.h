@@ -1,20 +1,96 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <string>
 
+#include <vca/config.h>
 #include <vca/filesystem.h>
 #include <vca/string.h>
+#include <vca/time.h>
 
 namespace vca
 {
 
+// Tracks the bytes read and the time spent extracting a file against its
+// limits. Tokenizers check it as they read so that reading stops once the
+// budget is used up or the extraction is cancelled by setting the given flag,
+// e.g. when the root dir being scanned is removed
+class ExtractionBudget
+{
+public:
+    explicit ExtractionBudget(const ExtractionLimits& limits,
+                              const std::atomic<bool>* cancelled = nullptr)
+        : m_limits{limits}
+        , m_cancelled{cancelled}
+    {
+    }
+
+    // Returns how many of the given bytes may be read next, zero once the
+    // budget is used up
+    size_t
+    available(const size_t byte_count) const
+    {
+        if (exhausted())
+        {
+            return 0;
+        }
+        if (m_limits.max_byte_count == 0)
+        {
+            return byte_count;
+        }
+        return std::min(byte_count, m_limits.max_byte_count - m_byte_count);
+    }
+
+    void
+    consume(const size_t byte_count)
+    {
+        m_byte_count += byte_count;
+    }
+
+    const ExtractionLimits&
+    limits() const
+    {
+        return m_limits;
+    }
+
+    bool
+    cancelled() const
+    {
+        return m_cancelled && *m_cancelled;
+    }
+
+    bool
+    exhausted() const
+    {
+        return cancelled() ||
+            (m_limits.max_byte_count > 0 &&
+             m_byte_count >= m_limits.max_byte_count) ||
+            (m_limits.max_time_ms > 0 &&
+             m_timer.us() > m_limits.max_time_ms * 1000);
+    }
+
+private:
+    ExtractionLimits m_limits;
+    const std::atomic<bool>* m_cancelled;
+    size_t m_byte_count = 0;
+    Timer m_timer;
+};
+
 class Tokenizer
 {
 public:
     virtual ~Tokenizer() = default;
 
-    virtual std::vector<String>
-    extract(const Path& file) const = 0;
+    // The name by which the extraction limits of this tokenizer are configured
+    virtual std::string
+    name() const = 0;
+
+    // Pushes the tokens of the file to the sink as they are extracted
+    virtual void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const = 0;
 };
 
 } // namespace vca
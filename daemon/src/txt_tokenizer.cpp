@@ -1,7 +1,5 @@
 #include "txt_tokenizer.h"
 
-#include <fstream>
-
 #include <vca/filesystem.h>
 #include <vca/logging.h>
 
@@ -11,7 +9,7 @@ namespace vca
 namespace
 {
 
-constexpr size_t g_max_byte_count = 8192;
+constexpr size_t g_chunk_size = 65536;
 
 }
 
@@ -20,45 +18,36 @@ TxtTokenizer::TxtTokenizer(const bool xml_unescape)
 {
 }
 
-std::vector<String>
-TxtTokenizer::extract(const Path& file) const
+std::string
+TxtTokenizer::name() const
+{
+    return "txt";
+}
+
+void
+TxtTokenizer::extract(const Path& file,
+                      TokenSink& sink,
+                      ExtractionBudget& budget) const
 {
-    String one_line;
+    FileReader reader{file};
+    if (!reader.is_open())
     {
-        auto f = make_ifstream(file, std::ios_base::binary);
-        try
-        {
-            one_line = narrow_to_wide(read_text(f, g_max_byte_count * 2));
-        }
-        catch (...)
-        {
-            VCA_DEBUG << "Read text failed for: " << file;
-            return {};
-        }
+        VCA_DEBUG << "Read text failed for: " << file;
+        return;
     }
 
-    replace_all(one_line, end_of_line_chars(), line_feed_char());
-    std::list<String> lines;
-    split(lines, one_line, line_feed_char());
-
-    one_line.clear();
-    for (const auto& line : lines)
+    TokenWriter writer{sink, m_xml_unescape};
+    while (const auto max_count = budget.available(g_chunk_size))
     {
-        if (line.back() == U'-')
-        {
-            one_line.insert(one_line.end(), line.begin(), line.end() - 1);
-        }
-        else
+        const auto chunk = reader.read(max_count);
+        if (chunk.empty())
         {
-            one_line += line + U" ";
+            break;
         }
+        budget.consume(chunk.size());
+        writer.write(chunk);
     }
-
-    if (m_xml_unescape)
-    {
-        xml_unescape(one_line);
-    }
-    return tokenize(std::move(one_line));
+    writer.flush();
 }
 
 } // namespace vca
@@ -10,8 +10,13 @@ class TxtTokenizer : public Tokenizer
 public:
     explicit TxtTokenizer(bool xml_unescape = false);
 
-    std::vector<String>
-    extract(const Path& file) const override;
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
 
 private:
     bool m_xml_unescape;
@@ -1,7 +1,5 @@
 #include "xml_tokenizer.h"
 
-#include <fstream>
-
 #include <vca/filesystem.h>
 #include <vca/logging.h>
 
@@ -11,29 +9,45 @@ namespace vca
 namespace
 {
 
-constexpr size_t g_max_byte_count = 8192;
+constexpr size_t g_chunk_size = 65536;
+
+}
 
+XmlTokenizer::XmlTokenizer(const bool html)
+    : m_html{html}
+{
+}
+
+std::string
+XmlTokenizer::name() const
+{
+    return m_html ? "html" : "xml";
 }
 
-std::vector<String>
-XmlTokenizer::extract(const Path& file) const
+void
+XmlTokenizer::extract(const Path& file,
+                      TokenSink& sink,
+                      ExtractionBudget& budget) const
 {
-    std::string content;
+    FileReader reader{file};
+    if (!reader.is_open())
     {
-        auto f = make_ifstream(file, std::ios_base::binary);
-        try
-        {
-            content = read_text(f, g_max_byte_count * 2);
-        }
-        catch (...)
+        VCA_DEBUG << "Read text failed for: " << file;
+        return;
+    }
+
+    XmlTextWriter writer{sink, m_html};
+    while (const auto max_count = budget.available(g_chunk_size))
+    {
+        const auto chunk = reader.read(max_count);
+        if (chunk.empty())
         {
-            VCA_DEBUG << "Read text failed for: " << file;
-            return {};
+            break;
         }
+        budget.consume(chunk.size());
+        writer.write(chunk);
     }
-
-    auto tag_content = xml_tag_content(content, g_max_byte_count);
-    return tokenize(std::move(tag_content));
+    writer.flush();
 }
 
 } // namespace vca
@@ -8,8 +8,19 @@ namespace vca
 class XmlTokenizer : public Tokenizer
 {
 public:
-    std::vector<String>
-    extract(const Path& file) const override;
+    // For HTML the contents of script and style elements are skipped
+    explicit XmlTokenizer(bool html = false);
+
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
+
+private:
+    bool m_html;
 };
 
 } // namespace vca
@@ -1,40 +1,47 @@
 #include "zipxml_tokenizer.h"
 
+#include <limits>
+
 #include <vca/logging.h>
 #include <vca/string.h>
-#include <vca/zip_inflater.h>
 
 namespace vca
 {
 
-namespace
+ZipxmlTokenizer::ZipxmlTokenizer(std::string entry)
+    : m_matcher{entry}
 {
-
-constexpr size_t g_max_byte_count = 81920;
-
 }
 
-ZipxmlTokenizer::ZipxmlTokenizer(std::string entry)
-    : m_entry{std::move(entry)}
+std::string
+ZipxmlTokenizer::name() const
 {
+    return "zipxml";
 }
 
-std::vector<String>
-ZipxmlTokenizer::extract(const Path& file) const
+void
+ZipxmlTokenizer::extract(const Path& file,
+                         TokenSink& sink,
+                         ExtractionBudget& budget) const
 {
-    std::string content;
+    XmlTextWriter writer{sink};
     try
     {
-        content = ZipInflater{file, g_max_byte_count, m_entry}.get();
+        const auto max_byte_count =
+            budget.available(std::numeric_limits<size_t>::max());
+        // stops inflating at the deadline or once cancelled
+        const auto write = [&writer, &budget](const std::string_view data) {
+            writer.write(data);
+            return !budget.exhausted();
+        };
+        budget.consume(inflate_zip(file, m_matcher, max_byte_count, write));
     }
     catch (...)
     {
         VCA_DEBUG << "Zip inflate failed for: " << file;
-        return {};
     }
-
-    auto tag_content = xml_tag_content(content, g_max_byte_count);
-    return tokenize(std::move(tag_content));
+    // tokenize what was inflated before an error, too
+    writer.flush();
 }
 
 } // namespace vca
@@ -1,20 +1,27 @@
-#pragma once
-
-#include "tokenizer.h"
-
-namespace vca
-{
-
-class ZipxmlTokenizer : public Tokenizer
-{
-public:
-    explicit ZipxmlTokenizer(std::string entry);
-
-    std::vector<String>
-    extract(const Path& file) const override;
-
-private:
-    std::string m_entry;
-};
-
-} // namespace vca
+#pragma once
+
+#include <vca/zip_inflater.h>
+
+#include "tokenizer.h"
+
+namespace vca
+{
+
+class ZipxmlTokenizer : public Tokenizer
+{
+public:
+    explicit ZipxmlTokenizer(std::string entry);
+
+    std::string
+    name() const override;
+
+    void
+    extract(const Path& file,
+            TokenSink& sink,
+            ExtractionBudget& budget) const override;
+
+private:
+    ZipEntryMatcher m_matcher;
+};
+
+} // namespace vca
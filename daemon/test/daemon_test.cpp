@@ -1,8 +1,19 @@
 #include <gtest/gtest.h>
 
+#include "extractor_pool.h"
+
+// The tokenizers of the extractor pools created by the tests, which start
+// this binary as their workers
+std::map<std::string, std::unique_ptr<vca::Tokenizer>>
+make_test_extractors();
+
 int
 main(int argc, char** argv)
 {
+    if (vca::is_extractor(argc, argv))
+    {
+        return vca::run_extractor(argc, argv, make_test_extractors());
+    }
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
@@ -0,0 +1,261 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <vca/time.h>
+
+#include "extractor_pool.h"
+#include "txt_tokenizer.h"
+
+namespace
+{
+
+// more than fit into the ring buffer of a worker at once, and not a divisor of
+// its size so that tokens wrap around its end
+constexpr size_t g_large_token_size = 5000;
+constexpr size_t g_large_token_count = 300;
+
+// larger than the ring buffer of a worker
+constexpr size_t g_huge_token_size = 4 * 1024 * 1024;
+
+constexpr size_t g_max_memory_byte_count = 64 * 1024 * 1024;
+
+// allocated step by step up to a bound, in case the limit is not enforced
+constexpr size_t g_greedy_step_byte_count = 1024 * 1024;
+constexpr size_t g_max_greedy_byte_count = 1024 * 1024 * 1024;
+
+// Tokenizers misbehaving in the ways the pool has to cope with
+class TestTokenizer : public vca::Tokenizer
+{
+public:
+    explicit TestTokenizer(std::string name)
+        : m_name{std::move(name)}
+    {
+    }
+
+    static std::string
+    large_token(const size_t index)
+    {
+        return std::string(g_large_token_size,
+                           static_cast<char>('a' + index % 26));
+    }
+
+    std::string
+    name() const override
+    {
+        return m_name;
+    }
+
+    void
+    extract(const vca::Path& /*file*/,
+            vca::TokenSink& sink,
+            vca::ExtractionBudget& budget) const override
+    {
+        if (m_name == "large")
+        {
+            for (size_t i = 0; i < g_large_token_count; ++i)
+            {
+                sink.push(large_token(i));
+            }
+        }
+        else if (m_name == "huge")
+        {
+            sink.push(std::string(g_huge_token_size, 'x'));
+            sink.push("after");
+        }
+        else if (m_name == "hanging")
+        {
+            sink.push("before");
+            for (;;)
+            {
+                std::this_thread::sleep_for(std::chrono::seconds{1});
+            }
+        }
+        else if (m_name == "aborting")
+        {
+            sink.push("before");
+            std::abort();
+        }
+        else if (m_name == "greedy")
+        {
+            sink.push("before");
+            std::vector<std::unique_ptr<char[]>> blocks;
+            for (;;)
+            {
+                if (blocks.size() * g_greedy_step_byte_count <
+                    g_max_greedy_byte_count)
+                {
+                    // touched so that the pages become resident
+                    blocks.emplace_back(new char[g_greedy_step_byte_count]);
+                    std::memset(blocks.back().get(), 1,
+                                g_greedy_step_byte_count);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+        }
+        else if (m_name == "cancellable")
+        {
+            sink.push("before");
+            while (!budget.cancelled())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+            sink.push("after");
+        }
+    }
+
+private:
+    std::string m_name;
+};
+
+class RecordingSink : public vca::TokenSink
+{
+public:
+    void
+    push(const std::string_view token) override
+    {
+        tokens.emplace_back(token);
+    }
+
+    std::vector<std::string> tokens;
+};
+
+vca::Path
+write_file(const std::string& name, const std::string& data)
+{
+    const vca::Path path{std::filesystem::temp_directory_path() /
+                         ("vca_extractor_pool_test_" + name)};
+    auto f = vca::make_ofstream(path, std::ios_base::binary);
+    f << data;
+    return path;
+}
+
+std::vector<std::string>
+extract(vca::ExtractorPool& pool,
+        const std::string& tokenizer,
+        const vca::Path& file,
+        const vca::ExtractionLimits& limits = {},
+        const std::atomic<bool>* cancelled = nullptr)
+{
+    RecordingSink sink;
+    const vca::ExtractionBudget budget{limits, cancelled};
+    pool.extract(tokenizer, file, sink, budget);
+    return sink.tokens;
+}
+
+// Checks that the worker still serves jobs
+void
+check_round_trip(vca::ExtractorPool& pool)
+{
+    const auto path = write_file("round_trip", "hello world");
+    const std::vector<std::string> tokens_exp{"hello", "world"};
+    ASSERT_EQ(tokens_exp, extract(pool, "txt", path));
+    vca::remove(path);
+}
+
+} // namespace
+
+std::map<std::string, std::unique_ptr<vca::Tokenizer>>
+make_test_extractors()
+{
+    std::map<std::string, std::unique_ptr<vca::Tokenizer>> tokenizers;
+    tokenizers.emplace("txt", std::make_unique<vca::TxtTokenizer>());
+    for (const auto name :
+         {"large", "huge", "hanging", "aborting", "greedy", "cancellable"})
+    {
+        tokenizers.emplace(name, std::make_unique<TestTokenizer>(name));
+    }
+    return tokenizers;
+}
+
+TEST(extractor_pool, extract)
+{
+    const auto path = write_file("extract", "The quick brown fox\njumps");
+    RecordingSink sink_exp;
+    vca::ExtractionBudget budget{vca::ExtractionLimits{}};
+    vca::TxtTokenizer{}.extract(path, sink_exp, budget);
+    vca::ExtractorPool pool{1, 0};
+    ASSERT_EQ(sink_exp.tokens, extract(pool, "txt", path));
+    vca::remove(path);
+}
+
+TEST(extractor_pool, extract_withTokensWrappingAroundRing)
+{
+    vca::ExtractorPool pool{1, 0};
+    const auto tokens = extract(pool, "large", vca::Path{"large"});
+    ASSERT_EQ(g_large_token_count, tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        ASSERT_EQ(TestTokenizer::large_token(i), tokens[i]);
+    }
+}
+
+TEST(extractor_pool, extract_withTokenLargerThanRing)
+{
+    vca::ExtractorPool pool{1, 0};
+    const auto tokens = extract(pool, "huge", vca::Path{"huge"});
+    ASSERT_EQ(2u, tokens.size());
+    ASSERT_FALSE(tokens[0].empty());
+    ASSERT_LT(tokens[0].size(), g_huge_token_size);
+    ASSERT_EQ(std::string(tokens[0].size(), 'x'), tokens[0]);
+    ASSERT_EQ("after", tokens[1]);
+}
+
+TEST(extractor_pool, extract_withTimeout)
+{
+    vca::ExtractorPool pool{1, 0};
+    const std::vector<std::string> tokens_exp{"before"};
+    vca::ExtractionLimits limits;
+    limits.max_time_ms = 100;
+    ASSERT_EQ(tokens_exp,
+              extract(pool, "hanging", vca::Path{"hanging"}, limits));
+    // the killed worker is restarted for the next job
+    check_round_trip(pool);
+}
+
+TEST(extractor_pool, extract_withCrash)
+{
+    vca::ExtractorPool pool{1, 0};
+    const std::vector<std::string> tokens_exp{"before"};
+    ASSERT_EQ(tokens_exp, extract(pool, "aborting", vca::Path{"aborting"}));
+    // the crashed worker is restarted for the next job
+    check_round_trip(pool);
+}
+
+#ifdef VCA_PLATFORM_LINUX
+TEST(extractor_pool, extract_withMemoryLimit)
+{
+    vca::ExtractorPool pool{1, g_max_memory_byte_count};
+    const std::vector<std::string> tokens_exp{"before"};
+    vca::Timer timer;
+    ASSERT_EQ(tokens_exp, extract(pool, "greedy", vca::Path{"greedy"}));
+    // long before the default time limit kills the worker
+    ASSERT_LT(timer.us(), 10u * 1000 * 1000);
+    check_round_trip(pool);
+}
+#endif
+
+TEST(extractor_pool, extract_withCancellation)
+{
+    vca::ExtractorPool pool{1, 0};
+    for (const auto tokenizer : {"cancellable", "hanging"})
+    {
+        std::atomic<bool> cancelled{false};
+        std::thread canceller{[&cancelled] {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            cancelled = true;
+        }};
+        vca::Timer timer;
+        const auto tokens =
+            extract(pool, tokenizer, vca::Path{tokenizer}, {}, &cancelled);
+        canceller.join();
+        ASSERT_FALSE(tokens.empty());
+        ASSERT_EQ("before", tokens.front());
+        // long before the default time limit kills the worker
+        ASSERT_LT(timer.us(), 10u * 1000 * 1000);
+        check_round_trip(pool);
+    }
+}
@@ -0,0 +1,37 @@
+#include <map>
+
+#include <gtest/gtest.h>
+
+#include "pdf_tokenizer.h"
+
+namespace
+{
+
+// has several pages, so that they are parsed in parallel
+const vca::Path g_pdf{std::string{VCA_SOURCE_DIR} +
+                      "/test/data/Reports/Project proposal.pdf"};
+
+std::map<std::string, size_t>
+extract(const vca::PdfTokenizer& tokenizer)
+{
+    vca::TokenCounter counter;
+    vca::ExtractionBudget budget{vca::ExtractionLimits{}};
+    tokenizer.extract(g_pdf, counter, budget);
+    std::map<std::string, size_t> counts;
+    for (const auto& term : counter.terms())
+    {
+        counts.emplace(term.term, term.frequency);
+    }
+    return counts;
+}
+
+} // namespace
+
+// Build with vca_enable_tsan to check that the pages parsed on the pool touch
+// no objects of the document
+TEST(pdf_tokenizer, extract_withPagesInParallel)
+{
+    const auto counts = extract(vca::PdfTokenizer{4});
+    ASSERT_FALSE(counts.empty());
+    ASSERT_EQ(extract(vca::PdfTokenizer{}), counts);
+}
@@ -1,39 +1,126 @@
 #!/usr/bin/env python
 
-import pandas as pd
-import math
-import os 
+# Generates core/vca/case_mappings.cpp from the simple case mappings in
+# UnicodeData.txt. Each mapping is stored as a two-level table: a stage-1
+# index per block of code points into deduplicated stage-2 blocks holding
+# the delta to add to a code point
+
+import os
+
 dir_path = os.path.dirname(os.path.realpath(__file__))
 
-data = pd.read_csv(os.path.join(dir_path, "UnicodeData.txt"), sep=";", header=None)
+
+def read_mappings():
+    lower = {}
+    upper = {}
+    with open(os.path.join(dir_path, "UnicodeData.txt")) as f:
+        for line in f:
+            fields = line.split(";")
+            c = int(fields[0], 16)
+            if fields[12]:
+                upper[c] = int(fields[12], 16)
+            if fields[13]:
+                lower[c] = int(fields[13], 16)
+    return lower, upper
+
+
+def make_tables(mapping, shift):
+    block_size = 1 << shift
+    char_count = max(mapping) + 1
+    block_count = (char_count + block_size - 1) // block_size
+    blocks = []
+    block_ids = {}
+    index = []
+    for b in range(block_count):
+        block = tuple(
+            mapping.get(c, c) - c
+            for c in range(b * block_size, (b + 1) * block_size)
+        )
+        if block not in block_ids:
+            block_ids[block] = len(blocks)
+            blocks.append(block)
+        index.append(block_ids[block])
+    return index, blocks
+
+
+def table_size(index, blocks):
+    index_type_size = 1 if len(blocks) <= 256 else 2
+    return len(index) * index_type_size + len(blocks) * len(blocks[0]) * 4
+
+
+def best_tables(mapping):
+    tables = {shift: make_tables(mapping, shift) for shift in range(4, 10)}
+    shift = min(tables, key=lambda s: table_size(*tables[s]))
+    return shift, tables[shift]
+
+
+def write_values(f, values, indent):
+    line = " " * (indent - 1)
+    for value in values:
+        item = " %d," % value
+        if len(line) + len(item) > 80:
+            f.write(line + "\n")
+            line = " " * (indent - 1)
+        line += item
+    f.write(line + "\n")
+
+
+def write_table(f, name, mapping):
+    shift, (index, blocks) = best_tables(mapping)
+    index_type = "uint8_t" if len(blocks) <= 256 else "uint16_t"
+    block_size = 1 << shift
+    f.write("constexpr unsigned g_%s_shift = %d;\n" % (name, shift))
+    f.write("constexpr Char g_%s_size = 0x%X;\n\n" % (name, len(index) << shift))
+    f.write("constexpr %s g_%s_index[%d]{\n" % (index_type, name, len(index)))
+    write_values(f, index, 4)
+    f.write("};\n\n")
+    f.write(
+        "constexpr int32_t g_%s_deltas[%d][%d]{\n" % (name, len(blocks), block_size)
+    )
+    for block in blocks:
+        f.write("    {\n")
+        write_values(f, block, 8)
+        f.write("    },\n")
+    f.write("};\n\n")
+
+
+def write_function(f, name, table, ascii_first):
+    f.write("Char\n")
+    f.write("%s(const Char c)\n" % name)
+    f.write("{\n")
+    f.write("    if (c < 0x80)\n")
+    f.write("    {\n")
+    f.write("        // branch-free, flips the case bit of letters\n")
+    f.write(
+        "        return c ^ static_cast<Char>((c - U'%s' < 26u) << 5);\n" % ascii_first
+    )
+    f.write("    }\n")
+    f.write("    if (c >= g_%s_size)\n" % table)
+    f.write("    {\n")
+    f.write("        return c;\n")
+    f.write("    }\n")
+    f.write("    const auto block = g_%s_index[c >> g_%s_shift];\n" % (table, table))
+    f.write(
+        "    const auto delta = g_%s_deltas[block][c & ((1u << g_%s_shift) - 1)];\n"
+        % (table, table)
+    )
+    f.write("    return c + static_cast<Char>(delta);\n")
+    f.write("}\n\n")
+
+
+lower, upper = read_mappings()
 
 with open(os.path.join(dir_path, "..", "core", "vca", "case_mappings.cpp"), "w") as f:
-    f.write('// Auto-generated via data/create_case_mappings.py. Do not edit by hand!\n')
+    f.write("// Auto-generated via data/create_case_mappings.py. Do not edit by hand!\n")
     f.write('#include "case_mappings.h"\n\n')
-    f.write('namespace vca\n')
-    f.write('{\n\n')
-    f.write('const std::unordered_map<Char, Char>&\n')
-    f.write('lower_to_upper_map()\n')
-    f.write('{\n')
-    f.write('    static const std::unordered_map<Char, Char> map{\n')
-    for _, row in data.iterrows():
-        l = row[0]
-        u = row[12]
-        if type(u) == str:
-            f.write("        {0x%s, 0x%s},\n" % (l, u))
-    f.write('    };\n')
-    f.write('    return map;\n')
-    f.write('}\n\n')
-    f.write('const std::unordered_map<Char, Char>&\n')
-    f.write('upper_to_lower_map()\n')
-    f.write('{\n')
-    f.write('    static const std::unordered_map<Char, Char> map{\n')
-    for _, row in data.iterrows():
-        u = row[0]
-        l = row[13]
-        if type(l) == str:
-            f.write("        {0x%s, 0x%s},\n" % (u, l))
-    f.write('    };\n')
-    f.write('    return map;\n')
-    f.write('}\n')
-    f.write('\n} // namespace vca\n')
+    f.write("#include <cstdint>\n\n")
+    f.write("namespace vca\n")
+    f.write("{\n\n")
+    f.write("namespace\n")
+    f.write("{\n\n")
+    write_table(f, "lower", lower)
+    write_table(f, "upper", upper)
+    f.write("} // namespace\n\n")
+    write_function(f, "lower_case", "lower", "A")
+    write_function(f, "upper_case", "upper", "a")
+    f.write("} // namespace vca\n")